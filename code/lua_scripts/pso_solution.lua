@@ -235,8 +235,16 @@ CPT = {
 }
 
 function load_parameters()
-    log("[INFO] Loading parameters")
-    lines = lines_from("input/parameters.csv")
+    -- The loop functions read the parameters file once for all the robots and push its values in PUSHED_PARAMETERS
+    -- Without them, the file can be given per run through the environment (used by PSO to run several simulations at once)
+    -- It is read again after every reset, the in-process PSO engine changes it between two experiments
+    if PUSHED_PARAMETERS then
+        lines = PUSHED_PARAMETERS
+    else
+        PARAMETERS_FILE = os.getenv("FORAGING_PARAMETERS") or "input/parameters.csv"
+        log("[INFO] Loading parameters from " .. PARAMETERS_FILE)
+        lines = lines_from(PARAMETERS_FILE)
+    end
 
     -- Importing parameters
     PARAM.speed                 = math.floor(tonumber(lines[1]))
@@ -264,61 +272,76 @@ end
 
 ------------------------------ VARIABLES ------------------------------------
 
-STATE = READY
-JOB = NESTER -- the robot first think he is a nester, it will transform if it sees an object
-
--- Pseudo constants : they will be assign once the robot will be sure of their value
-FLOOR = {
-    cache = UNKNOWN, -- color/value of the cache
-    nest  = UNKNOWN,
-    temp  = UNKNOWN -- color/value stored by the robot when it only has seen one floor color
-}
-
--- Obstacle avoidance
-OBSTACLE = {
-    sensed   = false, -- if an obstacle is sensed
-    angle    = 0, -- angle of the closest obstacle
-    distance = 0 -- distance of the closest obstacle
-}
-
--- Robot avoidance
-ROBOT = {
-    sensed   = false, -- if an robot is sensed
-    angle    = 0, -- angle of the closest robot
-    distance = 0 -- distance of the closest robot
-}
-
--- Occupied robot avoidance
-OCCUPIED_ROBOT = {
-    sensed   = false,
-    angle    = 0,
-    distance = 0
-}
-
--- Object foraging
-OBJECT = {
-    sensed   = false,
-    angle    = 0,
-    distance = 0
-}
-
--- Light detection
-LIGHT = {
-    sensed = false,
-    angle  = 0,
-    value  = 0
-}
+-- The variables are set in a function so that reset() can bring the robot back to its initial state
+function init_variables()
+    STATE = READY
+    JOB = NESTER -- the robot first think he is a nester, it will transform if it sees an object
+
+    -- Pseudo constants : they will be assign once the robot will be sure of their value
+    FLOOR = {
+        cache = UNKNOWN, -- color/value of the cache
+        nest  = UNKNOWN,
+        temp  = UNKNOWN -- color/value stored by the robot when it only has seen one floor color
+    }
+
+    -- Obstacle avoidance
+    OBSTACLE = {
+        sensed   = false, -- if an obstacle is sensed
+        angle    = 0, -- angle of the closest obstacle
+        distance = 0 -- distance of the closest obstacle
+    }
+
+    -- Robot avoidance
+    ROBOT = {
+        sensed   = false, -- if an robot is sensed
+        angle    = 0, -- angle of the closest robot
+        distance = 0 -- distance of the closest robot
+    }
+
+    -- Occupied robot avoidance
+    OCCUPIED_ROBOT = {
+        sensed   = false,
+        angle    = 0,
+        distance = 0
+    }
+
+    -- Object foraging
+    OBJECT = {
+        sensed   = false,
+        angle    = 0,
+        distance = 0
+    }
+
+    -- Light detection
+    LIGHT = {
+        sensed = false,
+        angle  = 0,
+        value  = 0
+    }
+
+    -- grey areas detection
+    GREY = {
+        sensed = false,
+        angles = {false,false,false,false},
+        value  = 0
+    }
+
+    -- Object gripping
+    IS_TOUCHING_OBJECT_WITH_GRIPPER = false
+    IS_GRABING_OBJECT = false
 
--- grey areas detection
-GREY = {
-    sensed = false,
-    angles = {false,false,false,false},
-    value  = 0
-}
+    -- Counters (their limits are derivated parameters, see load_parameters())
+    CPT.grabing.current          = 0
+    CPT.walk_away.current        = 0
+    CPT.global.current           = 0
+    CPT.steping_in_cache.current = 0
+    CPT.leaving_cache.current    = 0
+    CPT.unloading.current        = 0
+    CPT.reach_object.current     = 0
+    CPT.finishing.current        = 0
+end
 
--- Object gripping
-IS_TOUCHING_OBJECT_WITH_GRIPPER = false
-IS_GRABING_OBJECT = false
+init_variables()
 
 -----------------------------------------------------------------------------------
 ------------------------------ Collecting information -----------------------------
@@ -332,6 +355,10 @@ IS_GRABING_OBJECT = false
 
     The "check" functions don't make any actions. They only read the sensors of the robots and
     store the information found.
+
+    When the loop functions register sensor_digest() (see code/src/sensor_digest.h), the checks of the
+    camera, proximity and light sensors are done by this native function in a single pass, with the same
+    results. The functions below are then only used when the script runs without these loop functions.
 ]]
 
 ------------------------------ PROXIMITY ------------------------------------------
@@ -726,12 +753,19 @@ function script_1()
     
     -- Collecting information : we don't read all the sensors all the time, only the one we need for the current iteration. This allows to save a little bit of computation time
     if need_ground_color()           then check_ground_color() end
-    if need_closest_obstacle()       then check_closest_obstacle() end
-    if need_closest_robot()          then check_closest_robot() end
-    if need_closest_occupied_robot() then check_closest_occupied_robot() end
-    if need_closest_object()         then check_closest_object() end
-    if need_light()                  then check_light() end
-    if need_touching_object()        then check_touch_object_with_gripper() end
+    if sensor_digest then -- registered by the loop functions, one pass over the sensors for every check below
+        local touching = sensor_digest(need_closest_obstacle() and OBSTACLE, need_closest_robot() and ROBOT,
+                                       need_closest_occupied_robot() and OCCUPIED_ROBOT, need_closest_object() and OBJECT,
+                                       need_light() and LIGHT, need_touching_object())
+        if need_touching_object() then IS_TOUCHING_OBJECT_WITH_GRIPPER = touching end
+    else
+        if need_closest_obstacle()       then check_closest_obstacle() end
+        if need_closest_robot()          then check_closest_robot() end
+        if need_closest_occupied_robot() then check_closest_occupied_robot() end
+        if need_closest_object()         then check_closest_object() end
+        if need_light()                  then check_light() end
+        if need_touching_object()        then check_touch_object_with_gripper() end
+    end
 
     -- Passing through the router
     CPT.global.current = CPT.global.current + 1 -- update global counter
@@ -1054,7 +1088,10 @@ function step()
     script_1()
 end
 
+-- The experiment can be reset (in the simulator, or by the PSO engine between two evaluations) :
+-- the robot starts over, and load_parameters() is called again at the first step
 function reset()
+    init_variables()
 end
 
 function destroy()
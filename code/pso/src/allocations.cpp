@@ -0,0 +1,33 @@
+/**********************************************
+ * Global operator new and delete that count *
+ **********************************************/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocations.h"
+
+using namespace std;
+
+static atomic<long> nb_allocations(0);
+
+long countedAllocations() {
+    return nb_allocations.load();
+}
+
+// The array and nothrow forms of the standard library call this one
+void * operator new(size_t size) {
+    nb_allocations++;
+    void * pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == NULL) { throw bad_alloc(); }
+    return pointer;
+}
+
+void operator delete(void * pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void * pointer, size_t size) noexcept {
+    free(pointer);
+}
@@ -0,0 +1,14 @@
+/*******************************************************
+ * Counting allocator, for the "make allocations" check *
+ *******************************************************/
+
+#ifndef _ALLOCATIONS_H_
+#define _ALLOCATIONS_H_
+
+/**
+ * Number of calls to operator new since the process started, from every thread.
+ * Only defined when allocations.cpp is linked, which replaces the global operator new and delete.
+ */
+long countedAllocations();
+
+#endif
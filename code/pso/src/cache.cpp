@@ -0,0 +1,98 @@
+/*************************************
+ * Implementation of the class Cache *
+ *************************************/
+
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+
+#include "cache.h"
+#include "errors.h"
+#include "files.h"
+
+using namespace std;
+
+Cache::Cache() {
+    m_hits = 0;
+    m_misses = 0;
+}
+
+Cache::~Cache(){};
+
+// A missing file is an empty cache, it will be created by the first stored run
+bool Cache::load(string fileName, vector<double> * steps) {
+    m_fileName = fileName;
+    m_steps = *steps;
+    m_results.clear();
+
+    ifstream myStream(m_fileName);
+    if (!myStream) { return true; }
+
+    string line;
+    while (getline(myStream, line)) {
+        istringstream run(line);
+        string scenario;
+        int seed;
+        vector<double> values;
+        double value;
+
+        run >> scenario >> seed;
+        while (run >> value) {
+            values.push_back(value);
+        }
+        if (values.size() != m_steps.size() + 1) {
+            generateError("cache.cpp","load","malformed line in the cache","line",line);
+            return false;
+        }
+
+        double result = values.back();
+        values.pop_back();
+        // With a tolerance several runs can share a key, the first one stays
+        m_results.insert(make_pair(key(scenario, seed, &values), result));
+    }
+
+    return true;
+}
+
+bool Cache::find(string scenario, int seed, vector<double> * x, double * result) {
+    map<string, double>::iterator it = m_results.find(key(scenario, seed, x));
+    if (it == m_results.end()) {
+        m_misses++;
+        return false;
+    }
+    *result = it->second;
+    m_hits++;
+    return true;
+}
+
+bool Cache::store(string scenario, int seed, vector<double> * x, double result) {
+    m_results.insert(make_pair(key(scenario, seed, x), result));
+
+    char buffer[32];
+    string line = scenario + " " + to_string(seed);
+    for (int i = 0; i < x->size(); i++) {
+        snprintf(buffer, sizeof(buffer), " %.17g", x->at(i));
+        line += buffer;
+    }
+    snprintf(buffer, sizeof(buffer), " %.17g", result);
+    line += buffer;
+
+    char * cfileName = &m_fileName[0];
+    return appendToFile(cfileName, line);
+}
+
+// Without tolerance the key is the position as the lua controller reads it (6 decimals in the parameters file),
+// otherwise each feature is rounded to its quantization step
+string Cache::key(string scenario, int seed, vector<double> * x) {
+    string result = scenario + " " + to_string(seed);
+    for (int i = 0; i < x->size(); i++) {
+        if (m_steps[i] > 0) {
+            result += " " + to_string(llround(x->at(i)/m_steps[i]));
+        }
+        else {
+            result += " " + to_string(x->at(i));
+        }
+    }
+    return result;
+}
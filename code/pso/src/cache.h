@@ -0,0 +1,43 @@
+/**********************************
+ * Declaration of the class Cache *
+ **********************************/
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <vector>
+#include <string>
+#include <map>
+
+using namespace std;
+
+/**
+ * Results of the argos runs already done, stored on disk so that every PSO run can reuse them.
+ * One line of the file per run : <scenario> <seed> <x_1> ... <x_n> <result>
+ * The positions are stored as they are, the tolerance only changes the keys, so a file can be reused with
+ * another tolerance.
+ */
+class Cache {
+
+public:
+
+    string m_fileName;
+    vector<double> m_steps; // quantization step of each feature, 0 means exact positions
+    map<string, double> m_results;
+
+    int m_hits;
+    int m_misses;
+
+    Cache();
+    ~Cache();
+
+    bool load(string fileName, vector<double> * steps); // Reads the runs already stored in the file
+    bool find(string scenario, int seed, vector<double> * x, double * result);
+    bool store(string scenario, int seed, vector<double> * x, double result); // Adds the run to the cache and to the file
+
+private:
+
+    string key(string scenario, int seed, vector<double> * x);
+};
+
+#endif
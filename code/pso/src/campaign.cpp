@@ -0,0 +1,344 @@
+/******************************************************************
+ * Campaign runner : runs a whole grid of argos experiments       *
+ * (scenario, robots, seed) on every core and appends the results *
+ * to a csv file with the schema SCENARIO, ROBOTS, SEED, RESULT   *
+ ******************************************************************/
+
+/*
+ * Usage : ./campaign --scenarios <list> --robots <list> --seeds <list> [--controller pso|native|manual]
+ *                    [--parameters <file>] [--output <file>] [--jobs <int>] [--verbose <bool>]
+ *
+ * A list is made of values and ranges separated by commas, for instance 1-10 or 2,13,150.
+ * The cells already in the output file are skipped, so an interrupted campaign is continued by running the same
+ * command again. The rows don't say which controller ran them : an output file holds the runs of one controller, by
+ * default "/code/output/campaign_<controller>.csv", and --output must name another file for another controller.
+ * The argos file of a cell is rendered from the template of its scenario (see scenario.h), so any number of robots
+ * and any seed can be run.
+ *
+ * Scheduling : the cells are sorted by decreasing number of robots, the longest runs, and dealt to the jobs in
+ * turn. Each job runs its own cells from the largest, and a job without cells steals the largest cell waiting
+ * in the queue of another job, so the campaign never ends with one job running a long experiment alone while
+ * it could have been started earlier.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "errors.h"
+#include "files.h"
+#include "scenario.h"
+#include "lists.h"
+
+using namespace std;
+
+// One experiment of the grid
+struct Cell {
+    int scenario;
+    int robots;
+    int seed;
+};
+
+/********************** GLOBAL VARIABLES **********************/
+
+vector<int> scenarios;
+vector<int> robots;
+vector<int> seeds;
+string controller; // pso, native (the pso one compiled with the loop functions) or manual
+string parameters_file; // parameters of the pso controller, relative to the code folder
+string output_file;
+int nb_jobs;
+bool verbose;
+
+map<int, Scenario> templates; // by scenario, only read once the jobs are started
+
+// Queues of the jobs, each one protected by its own mutex
+vector<deque<Cell>> queues;
+vector<mutex> queue_mutexes;
+
+mutex output_mutex; // protects the output file and the counters
+int nb_cells;
+int nb_done;
+int nb_failed;
+
+/********************** PARAMETERS **********************/
+
+void setDefaultParameters() {
+    scenarios = {2};
+    robots = {13};
+    seeds = {1,2,3,4,5,6,7,8,9,10};
+    controller = "pso";
+    parameters_file = "input/parameters.csv";
+    output_file = ""; // campaign_<controller>.csv once the controller is known
+    nb_jobs = thread::hardware_concurrency();
+    if (nb_jobs < 1) { nb_jobs = 1; }
+    verbose = true;
+}
+
+void printParameters() {
+    cout << "\nCampaign:" << endl;
+    cout << "   scenarios  = " << scenarios.size() << " values" << endl;
+    cout << "   robots     = " << robots.size() << " values" << endl;
+    cout << "   seeds      = " << seeds.size() << " values" << endl;
+    cout << "   controller = " << controller << endl;
+    cout << "   parameters = " << parameters_file << endl;
+    cout << "   output     = " << output_file << endl;
+    cout << "   nb_jobs    = " << nb_jobs << endl << endl;
+}
+
+bool readParameters(int argc, char *argv[]) {
+
+    setDefaultParameters();
+
+    int i = 1;
+    while (i < argc) {
+        if (i + 1 >= argc) {
+            cout << "Parameter " << argv[i] << " needs a value.\n";
+            return false;
+        }
+        if (strcmp(argv[i], "--scenarios") == 0) {
+            if (!parseList(argv[i+1], &scenarios)) { return false; }
+            i+=2;
+        } else if (strcmp(argv[i], "--robots") == 0) {
+            if (!parseList(argv[i+1], &robots)) { return false; }
+            i+=2;
+        } else if (strcmp(argv[i], "--seeds") == 0) {
+            if (!parseList(argv[i+1], &seeds)) { return false; }
+            i+=2;
+        } else if (strcmp(argv[i], "--controller") == 0) {
+            if (strcmp(argv[i+1], "pso") == 0 || strcmp(argv[i+1], "native") == 0 || strcmp(argv[i+1], "manual") == 0) {
+                controller = argv[i+1];
+            } else {
+                cout << "Parameter " << argv[i+1] << " no recognized.\n";
+                return false;
+            }
+            i+=2;
+        } else if (strcmp(argv[i], "--parameters") == 0) {
+            parameters_file = argv[i+1];
+            i+=2;
+        } else if (strcmp(argv[i], "--output") == 0) {
+            output_file = argv[i+1];
+            i+=2;
+        } else if (strcmp(argv[i], "--jobs") == 0) {
+            nb_jobs = atol(argv[i+1]);
+            i+=2;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            if (strcmp(argv[i+1], "true") == 0) {
+                verbose = true;
+            } else if (strcmp(argv[i+1], "false") == 0) {
+                verbose = false;
+            } else {
+                cout << "Parameter " << argv[i+1] << " no recognized.\n";
+                return false;
+            }
+            i+=2;
+        } else {
+            cout << "Parameter " << argv[i] << " no recognized.\n";
+            return false;
+        }
+    }
+
+    if (output_file == "") {
+        output_file = "../output/campaign_" + controller + ".csv";
+    }
+
+    if (nb_jobs < 1) {
+        generateError("campaign.cpp","readParameters","at least one job is needed","nb_jobs",nb_jobs);
+        return false;
+    }
+
+    if (verbose) { printParameters(); }
+
+    return true;
+}
+
+/********************** GRID **********************/
+
+// Cells already in the output file. A missing file is created with the header of the schema.
+bool readFinishedCells(set<tuple<int,int,int>> * finished) {
+    ifstream stream(output_file.c_str());
+    if (!stream) {
+        char * cfileName = &output_file[0];
+        return appendToFile(cfileName, "SCENARIO, ROBOTS, SEED, RESULT");
+    }
+
+    string line;
+    getline(stream, line); // header
+    while (getline(stream, line)) {
+        int scenario, nbRobots, seed;
+        if (sscanf(line.c_str(), "%d , %d , %d", &scenario, &nbRobots, &seed) == 3) {
+            finished->insert(make_tuple(scenario, nbRobots, seed));
+        }
+    }
+    return true;
+}
+
+// Every cell of the grid not finished yet, largest numbers of robots first, dealt to the queues in turn
+bool buildQueues() {
+    set<tuple<int,int,int>> finished;
+    if (!readFinishedCells(&finished)) { return false; }
+
+    for (int s = 0; s < scenarios.size(); s++) {
+        if (!templates[scenarios[s]].load("../" + templateFile(scenarios[s], controller))) { return false; }
+    }
+
+    vector<Cell> cells;
+    for (int s = 0; s < scenarios.size(); s++) {
+        for (int r = 0; r < robots.size(); r++) {
+            for (int k = 0; k < seeds.size(); k++) {
+                Cell cell = {scenarios[s], robots[r], seeds[k]};
+                if (finished.count(make_tuple(cell.scenario, cell.robots, cell.seed)) > 0) { continue; }
+                cells.push_back(cell);
+            }
+        }
+    }
+
+    stable_sort(cells.begin(), cells.end(), [](const Cell & a, const Cell & b) { return a.robots > b.robots; });
+
+    queues.resize(nb_jobs);
+    for (int c = 0; c < cells.size(); c++) {
+        queues[c % nb_jobs].push_back(cells[c]);
+    }
+    nb_cells = cells.size();
+
+    if (verbose) { cout << finished.size() << " rows already in the output file, " << nb_cells << " to run" << endl; }
+    return true;
+}
+
+// The job takes the first cell of its own queue, or steals the largest cell waiting in the other queues
+bool takeCell(int job, Cell * cell) {
+    {
+        lock_guard<mutex> lock(queue_mutexes[job]);
+        if (!queues[job].empty()) {
+            *cell = queues[job].front();
+            queues[job].pop_front();
+            return true;
+        }
+    }
+
+    while (true) {
+        int victim = -1;
+        int largest = -1;
+        for (int other = 0; other < nb_jobs; other++) {
+            lock_guard<mutex> lock(queue_mutexes[other]);
+            if (!queues[other].empty() && queues[other].front().robots > largest) {
+                largest = queues[other].front().robots;
+                victim = other;
+            }
+        }
+        if (victim < 0) { return false; }
+
+        // The victim may have taken its cell in the meantime, then another victim is chosen
+        lock_guard<mutex> lock(queue_mutexes[victim]);
+        if (!queues[victim].empty()) {
+            *cell = queues[victim].front();
+            queues[victim].pop_front();
+            return true;
+        }
+    }
+}
+
+/********************** RUNS **********************/
+
+string slotDirectory(int job) {
+    return "runs/campaign_" + to_string(job);
+}
+
+bool prepareSlot(int job) {
+    vector<string> folders = {"../runs", "../" + slotDirectory(job)};
+
+    for (int i = 0; i < folders.size(); i++) {
+        if (mkdir(folders[i].c_str(), 0755) != 0 && errno != EEXIST) {
+            generateError("campaign.cpp","prepareSlot","impossible to create a folder","folder",folders[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same execution of argos as the shell backend of PSO, in the folder of the job
+bool runCell(Cell * cell, int job, double * result) {
+    string directory = slotDirectory(job);
+    string outputFile = directory + "/outputArgos.csv";
+    string scenarioFile = directory + "/scenario.argos";
+
+    if (!templates.at(cell->scenario).write("../" + scenarioFile, cell->seed, cell->robots)) { return false; }
+
+    // A result left by a previous run must not be read if argos fails
+    string fileName = "../" + outputFile;
+    char * cfileName = &fileName[0];
+    if (!emptyFile(cfileName)) { return false; }
+
+    string command_line = "cd .. && FORAGING_PARAMETERS=" + parameters_file + " FORAGING_OUTPUT=" + outputFile
+                        + " argos3 -n -l " + directory + "/INFOFILE -e " + directory + "/ERRORFILE"
+                        + " -c " + scenarioFile;
+    char * char_command_line = &command_line[0];
+
+    int status = system(char_command_line);
+    if (status != 0) {
+        generateError("campaign.cpp","runCell","argos3 failed, see " + directory + "/ERRORFILE","status",status);
+        return false;
+    }
+
+    return readFirstDouble(cfileName, result);
+}
+
+// Rows are appended as soon as their run is finished, an interrupted campaign loses only the running cells
+bool appendRow(Cell * cell, double result) {
+    char row[128];
+    snprintf(row, sizeof(row), "%d, %d, %d, %g", cell->scenario, cell->robots, cell->seed, result);
+
+    lock_guard<mutex> lock(output_mutex);
+    char * cfileName = &output_file[0];
+    if (!appendToFile(cfileName, row)) { return false; }
+    nb_done++;
+    if (verbose) { cout << "[" << nb_done << "/" << nb_cells << "] " << row << endl; }
+    return true;
+}
+
+void work(int job) {
+    Cell cell;
+    double result;
+
+    while (takeCell(job, &cell)) {
+        if (!runCell(&cell, job, &result) || !appendRow(&cell, result)) {
+            lock_guard<mutex> lock(output_mutex);
+            nb_failed++;
+            generateError("campaign.cpp","work","the experiment failed","cell","s" + to_string(cell.scenario) + "_" + to_string(cell.robots) + "_" + to_string(cell.seed));
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (!readParameters(argc, argv)) { return 1; }
+
+    queue_mutexes = vector<mutex>(nb_jobs);
+    if (!buildQueues()) { return 1; }
+
+    for (int job = 0; job < nb_jobs; job++) {
+        if (!prepareSlot(job)) { return 1; }
+    }
+
+    vector<thread> threads;
+    for (int job = 0; job < nb_jobs; job++) {
+        threads.push_back(thread(work, job));
+    }
+    for (int job = 0; job < nb_jobs; job++) {
+        threads[job].join();
+    }
+
+    if (verbose) { cout << "\n" << nb_done << " cells done, " << nb_failed << " failed" << endl; }
+    return (nb_failed == 0 ? 0 : 1);
+}
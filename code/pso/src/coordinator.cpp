@@ -0,0 +1,176 @@
+/*******************************************
+ * Implementation of the class Coordinator *
+ *******************************************/
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "coordinator.h"
+#include "errors.h"
+
+using namespace std;
+
+Coordinator::Coordinator() {
+    m_socket = -1;
+    m_timeout = 0;
+    m_max_attempts = 5;
+    m_nb_connections = 0;
+    m_nb_events = 0;
+    m_stop = false;
+}
+
+Coordinator::~Coordinator() {
+    stop();
+}
+
+bool Coordinator::listen(int port, double timeout) {
+    m_timeout = timeout;
+    m_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_socket < 0) {
+        generateError("coordinator.cpp","listen","impossible to create the socket");
+        return false;
+    }
+
+    int enable = 1;
+    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(m_socket, (struct sockaddr *) &address, sizeof(address)) != 0 || ::listen(m_socket, 64) != 0) {
+        generateError("coordinator.cpp","listen","impossible to listen on the port","port",port);
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    m_acceptor = thread(&Coordinator::accept, this);
+    return true;
+}
+
+// A node may break during any run : the run is then given to another connection, up to m_max_attempts
+// connections. An ERROR answer counts as an attempt too, the connection itself is kept.
+bool Coordinator::evaluate(vector<double> * x, string experiment, int nb_robots, int seed, double * result) {
+    for (int attempt = 0; attempt < m_max_attempts; attempt++) {
+        Worker * connection = acquire();
+        if (connection == NULL) { break; }
+
+        if (connection->evaluate(x, experiment, nb_robots, seed, result)) {
+            release(connection, true);
+            return true;
+        }
+
+        // A connection that still answers only failed this run, a broken one has been stopped
+        release(connection, connection->m_started);
+    }
+
+    generateError("coordinator.cpp","evaluate","no node could run the simulation","seed",seed);
+    return false;
+}
+
+void Coordinator::stop() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        if (m_stop) { return; }
+        m_stop = true;
+    }
+    m_connection_available.notify_all();
+
+    if (m_socket >= 0) {
+        shutdown(m_socket, SHUT_RDWR); // wakes the acceptor up
+        close(m_socket);
+    }
+    if (m_acceptor.joinable()) { m_acceptor.join(); }
+
+    // The busy connections belong to the threads of the pool, which are stopped before
+    while (!m_idle.empty()) {
+        delete m_idle.front();
+        m_idle.pop_front();
+    }
+}
+
+void Coordinator::accept() {
+    while (true) {
+        int connection = ::accept4(m_socket, NULL, NULL, SOCK_CLOEXEC);
+        if (connection < 0) {
+            lock_guard<mutex> lock(m_mutex);
+            if (m_stop) { return; }
+            continue;
+        }
+
+        // Without answer for m_timeout seconds, fgets fails and the node is dropped
+        if (m_timeout > 0) {
+            struct timeval timeout;
+            timeout.tv_sec = (long) m_timeout;
+            timeout.tv_usec = (long) ((m_timeout - timeout.tv_sec)*1e6);
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+        int enable = 1;
+        setsockopt(connection, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+        setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        Worker * worker = new Worker();
+        if (!worker->attach(connection)) {
+            delete worker;
+            continue;
+        }
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_idle.push_back(worker);
+            m_nb_connections++;
+            m_nb_events++;
+            cout << "Node connected (" << m_nb_connections << " connections)" << endl;
+        }
+        m_connection_available.notify_one();
+    }
+}
+
+// Blocks until a connection is idle. NULL when the coordinator stops, or when no node has connected or finished
+// a run for m_timeout seconds : no node is connected, or all of them are stuck.
+Worker* Coordinator::acquire() {
+    unique_lock<mutex> lock(m_mutex);
+    while (!m_stop && m_idle.empty()) {
+        if (m_timeout <= 0) {
+            m_connection_available.wait(lock);
+            continue;
+        }
+        long nbEvents = m_nb_events;
+        if (m_connection_available.wait_for(lock, chrono::duration<double>(m_timeout)) == cv_status::timeout
+            && m_nb_events == nbEvents && m_idle.empty()) {
+            generateError("coordinator.cpp","acquire","no node available","seconds",m_timeout);
+            return NULL;
+        }
+    }
+    if (m_idle.empty()) { return NULL; }
+
+    Worker * connection = m_idle.front();
+    m_idle.pop_front();
+    return connection;
+}
+
+void Coordinator::release(Worker * connection, bool alive) {
+    if (!alive) {
+        delete connection;
+        lock_guard<mutex> lock(m_mutex);
+        m_nb_connections--;
+        m_nb_events++;
+        cout << "Node lost, its run is sent again (" << m_nb_connections << " connections)" << endl;
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_idle.push_back(connection);
+        m_nb_events++;
+    }
+    m_connection_available.notify_one();
+}
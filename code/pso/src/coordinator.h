@@ -0,0 +1,57 @@
+/****************************************
+ * Declaration of the class Coordinator *
+ ****************************************/
+
+#ifndef COORDINATOR_H_
+#define COORDINATOR_H_
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "worker.h"
+
+using namespace std;
+
+/**
+ * Server side of a distributed run : the PSO nodes (pso --node <host>:<port>) connect to the port of the
+ * coordinator, one connection per job they can run at the same time, and answer the evaluation requests with
+ * the protocol of the foraging workers (see worker.h). Every run of the coordinator is sent to an idle
+ * connection. A connection which breaks or stays silent longer than the timeout is dropped, and its run is
+ * sent again to another connection : nodes can be lost or added while PSO is running.
+ */
+class Coordinator {
+
+public:
+
+    int m_socket; // listening socket
+    double m_timeout; // seconds without answer before a node is considered lost, or without idle node before a run fails, 0 waits forever
+    int m_max_attempts; // connections tried for one run before giving up
+
+    thread m_acceptor; // accepts the new connections
+    deque<Worker*> m_idle; // connections waiting for a run
+    int m_nb_connections; // idle and busy
+    long m_nb_events; // connections accepted or released since the beginning, to tell a stalled run from a busy one
+    bool m_stop;
+
+    mutex m_mutex;
+    condition_variable m_connection_available;
+
+    Coordinator();
+    ~Coordinator();
+
+    bool listen(int port, double timeout); // Opens the port and starts accepting the nodes
+    bool evaluate(vector<double> * x, string experiment, int nb_robots, int seed, double * result); // Runs one simulation on a node
+    void stop(); // Closes the port and every connection
+
+private:
+
+    void accept();
+    Worker* acquire();
+    void release(Worker * connection, bool alive);
+};
+
+#endif
@@ -0,0 +1,116 @@
+/**************************************
+ * Implementation of the class Engine *
+ **************************************/
+
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+
+#include <argos3/core/simulator/simulator.h>
+#include <argos3/core/simulator/loop_functions.h>
+#include <argos3/core/utility/plugins/dynamic_loading.h>
+#include <argos3/core/utility/logging/argos_log.h>
+
+#include "engine.h"
+#include "errors.h"
+#include "files.h"
+
+using namespace std;
+using namespace argos;
+
+Engine::Engine() {
+    m_loaded = false;
+}
+
+Engine::~Engine() {
+    if (m_loaded) {
+        CSimulator::GetInstance().Destroy();
+    }
+}
+
+// Loads the plugins (found with ARGOS_PLUGIN_PATH, like the argos3 command) and the argos file.
+// The argos file refers to the lua script relatively to the folder argos is run from, so the experiment is
+// loaded from inside this folder. The files used after loading are given to argos with absolute paths.
+bool Engine::load(string directory, string config, string outputFile, string logDirectory) {
+    char buffer[PATH_MAX];
+    if (realpath(directory.c_str(), buffer) == NULL) {
+        generateError("engine.cpp","load","unknown folder","directory",directory);
+        return false;
+    }
+    m_directory = buffer;
+
+    m_log.close();
+    m_logErr.close();
+    m_log.open((m_directory + "/" + logDirectory + "/INFOFILE").c_str());
+    m_logErr.open((m_directory + "/" + logDirectory + "/ERRORFILE").c_str());
+    LOG.DisableColoredOutput();
+    LOGERR.DisableColoredOutput();
+    LOG.GetStream().rdbuf(m_log.rdbuf());
+    LOGERR.GetStream().rdbuf(m_logErr.rdbuf());
+
+    // The loop functions read FORAGING_OUTPUT only once, during their Init
+    m_outputFile = m_directory + "/" + outputFile;
+    setenv("FORAGING_OUTPUT", m_outputFile.c_str(), 1);
+
+    if (getcwd(buffer, PATH_MAX) == NULL || chdir(m_directory.c_str()) != 0) {
+        generateError("engine.cpp","load","impossible to move to the folder","directory",m_directory);
+        return false;
+    }
+    string workingDirectory = buffer;
+
+    bool loaded = true;
+    try {
+        CSimulator& cSimulator = CSimulator::GetInstance();
+        if (m_loaded) {
+            cSimulator.Destroy();
+            m_loaded = false;
+        }
+        CDynamicLoading::LoadAllLibraries();
+        cSimulator.SetExperimentFileName(config);
+        cSimulator.LoadExperiment();
+    }
+    catch(CARGoSException& ex) {
+        generateError("engine.cpp","load","impossible to load the experiment " + config + ": " + ex.what());
+        loaded = false;
+    }
+
+    if (chdir(workingDirectory.c_str()) != 0) {
+        generateError("engine.cpp","load","impossible to come back to the folder","directory",workingDirectory);
+        return false;
+    }
+
+    m_config = config;
+    m_loaded = loaded;
+    return loaded;
+}
+
+// The parameters file is relative to the folder of the experiment.
+// The lua controller reads FORAGING_PARAMETERS at the first step after the reset, and the loop functions
+// write their result in the output file at the end of the experiment
+bool Engine::run(string parametersFile, int seed, double * result) {
+    if (!m_loaded) {
+        generateError("engine.cpp","run","no experiment loaded");
+        return false;
+    }
+
+    setenv("FORAGING_PARAMETERS", (m_directory + "/" + parametersFile).c_str(), 1);
+
+    try {
+        CSimulator& cSimulator = CSimulator::GetInstance();
+        cSimulator.Reset(seed);
+        while (!cSimulator.IsExperimentFinished()) {
+            cSimulator.UpdateSpace();
+        }
+        cSimulator.GetLoopFunctions().PostExperiment();
+    }
+    catch(CARGoSException& ex) {
+        generateError("engine.cpp","run","experiment failed with seed " + to_string(seed) + ": " + ex.what());
+        return false;
+    }
+    LOG.Flush();
+    LOGERR.Flush();
+
+    string fileName = m_outputFile;
+    char * cfileName = &fileName[0];
+    return readFirstDouble(cfileName, result);
+}
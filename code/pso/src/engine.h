@@ -0,0 +1,37 @@
+/***********************************
+ * Declaration of the class Engine *
+ ***********************************/
+
+#ifndef ENGINE_H_
+#define ENGINE_H_
+
+#include <string>
+#include <fstream>
+
+using namespace std;
+
+/**
+ * Runs the experiments inside the PSO process, with the argos simulator library.
+ * The argos file is loaded once, then each evaluation is a Reset() of the simulator with a new seed.
+ * Argos only allows one simulator per process, so there is at most one loaded engine.
+ */
+class Engine {
+
+public:
+
+    string m_directory; // absolute path of the folder argos is run from, all the other paths are relative to it
+    string m_config; // argos file loaded in the simulator
+    string m_outputFile; // file where the loop functions write the number of objects in the nest
+    bool m_loaded;
+
+    ofstream m_log; // argos logs, the equivalent of INFOFILE and ERRORFILE of the argos3 command
+    ofstream m_logErr;
+
+    Engine();
+    ~Engine();
+
+    bool load(string directory, string config, string outputFile, string logDirectory);
+    bool run(string parametersFile, int seed, double * result); // Runs one full experiment on the given seed
+};
+
+#endif
@@ -0,0 +1,258 @@
+/******************************************************************
+ * Equivalence check : runs the lua pso controller and its native *
+ * port on the same experiments and compares them step by step    *
+ ******************************************************************/
+
+/*
+ * Usage : ./equivalence [--scenarios <list>] [--robots <list>] [--seeds <list>] [--parameters <file>]
+ *                       [--verbose <bool>]
+ *
+ * Lists as in the campaign runner (1-10 or 2,13,150), default scenario 2, 13 robots and seeds 1 to 3.
+ * Every (scenario, robots, seed) cell is rendered from the template of both controllers, with the metrics of the
+ * loop functions sampled at every step, and run with argos3. The two metrics streams must be the same : objects
+ * in the nest and in the cache, robots colliding and robots in each state of the controller, at every step.
+ * The results of the objective must be the same too. The first difference of a cell is printed, and the exit
+ * status is 1 when a cell differs or fails.
+ *
+ * The lua script never defines WALK_AWAY, so the STATE of its robots walking away is nil and they aren't counted
+ * in the lua metrics : the robots without state of the lua run are compared with the WALK_AWAY robots of the
+ * native run.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "errors.h"
+#include "files.h"
+#include "scenario.h"
+#include "lists.h"
+
+using namespace std;
+
+// Rows of a metrics file of the loop functions, by column name
+struct Metrics {
+    vector<string> columns;
+    vector<vector<uint32_t>> rows;
+};
+
+/********************** GLOBAL VARIABLES **********************/
+
+vector<int> scenarios;
+vector<int> robots;
+vector<int> seeds;
+string parameters_file; // parameters of both controllers, relative to the code folder
+bool verbose;
+
+const string directory = "runs/equivalence";
+const vector<string> controllers = {"pso", "native"};
+
+/********************** PARAMETERS **********************/
+
+void setDefaultParameters() {
+    scenarios = {2};
+    robots = {13};
+    seeds = {1,2,3};
+    parameters_file = "input/parameters.csv";
+    verbose = true;
+}
+
+bool readParameters(int argc, char *argv[]) {
+
+    setDefaultParameters();
+
+    int i = 1;
+    while (i < argc) {
+        if (i + 1 >= argc) {
+            cout << "Parameter " << argv[i] << " needs a value.\n";
+            return false;
+        }
+        if (strcmp(argv[i], "--scenarios") == 0) {
+            if (!parseList(argv[i+1], &scenarios)) { return false; }
+            i+=2;
+        } else if (strcmp(argv[i], "--robots") == 0) {
+            if (!parseList(argv[i+1], &robots)) { return false; }
+            i+=2;
+        } else if (strcmp(argv[i], "--seeds") == 0) {
+            if (!parseList(argv[i+1], &seeds)) { return false; }
+            i+=2;
+        } else if (strcmp(argv[i], "--parameters") == 0) {
+            parameters_file = argv[i+1];
+            i+=2;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            if (strcmp(argv[i+1], "true") == 0) {
+                verbose = true;
+            } else if (strcmp(argv[i+1], "false") == 0) {
+                verbose = false;
+            } else {
+                cout << "Parameter " << argv[i+1] << " no recognized.\n";
+                return false;
+            }
+            i+=2;
+        } else {
+            cout << "Parameter " << argv[i] << " no recognized.\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/********************** RUNS **********************/
+
+// The argos file of the cell, with the metrics sampled at every step
+bool writeScenario(Scenario * scenario, string fileName, int seed, int nbRobots) {
+    string text = scenario->render(seed, nbRobots);
+    size_t params = text.find("<params ");
+    if (params == string::npos || text.find("metrics_every") != string::npos) {
+        generateError("equivalence.cpp","writeScenario","no params tag, or metrics_every already set, in the template","file_name",scenario->m_template_file);
+        return false;
+    }
+    text.insert(params + string("<params ").size(), "metrics_every=\"1\" ");
+
+    ofstream stream(fileName.c_str());
+    stream << text;
+    if (!stream) {
+        generateError("equivalence.cpp","writeScenario","impossible to write a file","file_name",fileName);
+        return false;
+    }
+    return true;
+}
+
+// Same execution of argos as the shell backend of PSO, with the metrics file of the controller
+bool runController(string controller, double * result) {
+    string outputFile = directory + "/" + controller + "_output.csv";
+    string fileName = "../" + outputFile;
+    char * cfileName = &fileName[0];
+    if (!emptyFile(cfileName)) { return false; }
+
+    string command_line = "cd .. && FORAGING_PARAMETERS=" + parameters_file + " FORAGING_OUTPUT=" + outputFile
+                        + " FORAGING_METRICS=" + directory + "/" + controller + "_metrics.bin"
+                        + " argos3 -n -l " + directory + "/INFOFILE -e " + directory + "/ERRORFILE"
+                        + " -c " + directory + "/" + controller + ".argos";
+    char * char_command_line = &command_line[0];
+
+    int status = system(char_command_line);
+    if (status != 0) {
+        generateError("equivalence.cpp","runController","argos3 failed, see " + directory + "/ERRORFILE","controller",controller);
+        return false;
+    }
+    return readFirstDouble(cfileName, result);
+}
+
+// Layout written by CForaging::WriteMetrics (see foraging.cpp)
+bool readMetrics(string fileName, Metrics * metrics) {
+    ifstream stream(fileName.c_str(), ios::binary);
+    string magic, names;
+    int version, nbColumns, nbRows;
+    if (!(stream >> magic >> version >> nbColumns >> nbRows) || magic != "FORAGING_METRICS" || version != 1) {
+        generateError("equivalence.cpp","readMetrics","not a metrics file","file_name",fileName);
+        return false;
+    }
+    stream.ignore(1);
+    getline(stream, names);
+    istringstream columns(names);
+    string column;
+    metrics->columns.clear();
+    while (columns >> column) {
+        metrics->columns.push_back(column);
+    }
+
+    metrics->rows.assign(nbRows, vector<uint32_t>(nbColumns));
+    for (int row = 0; row < nbRows; row++) {
+        stream.read(reinterpret_cast<char*>(&metrics->rows[row][0]), nbColumns*sizeof(uint32_t));
+    }
+    if (!stream || metrics->columns.size() != nbColumns) {
+        generateError("equivalence.cpp","readMetrics","truncated metrics file","file_name",fileName);
+        return false;
+    }
+    return true;
+}
+
+// Values of a row by column name, the robots without state of the lua run counted as WALK_AWAY
+map<string, uint32_t> rowValues(Metrics * metrics, int row, string controller, int nbRobots) {
+    map<string, uint32_t> values;
+    uint32_t nbInStates = 0;
+    for (int c = 0; c < metrics->columns.size(); c++) {
+        values[metrics->columns[c]] = metrics->rows[row][c];
+        if (c >= 4) { nbInStates += metrics->rows[row][c]; }
+    }
+    if (controller == "pso") { values["WALK_AWAY"] += nbRobots - nbInStates; }
+    return values;
+}
+
+// Prints the first difference between the two runs of the cell
+bool compareCell(int scenario, int nbRobots, int seed) {
+    Metrics metrics[2];
+    double results[2];
+    for (int k = 0; k < 2; k++) {
+        if (!runController(controllers[k], &results[k])) { return false; }
+        if (!readMetrics("../" + directory + "/" + controllers[k] + "_metrics.bin", &metrics[k])) { return false; }
+    }
+
+    string cell = "s" + to_string(scenario) + "_" + to_string(nbRobots) + "_" + to_string(seed);
+    if (metrics[0].rows.size() != metrics[1].rows.size()) {
+        cout << cell << " : " << metrics[0].rows.size() << " steps with lua, " << metrics[1].rows.size() << " with native" << endl;
+        return false;
+    }
+    for (int row = 0; row < metrics[0].rows.size(); row++) {
+        map<string, uint32_t> lua = rowValues(&metrics[0], row, "pso", nbRobots);
+        map<string, uint32_t> native = rowValues(&metrics[1], row, "native", nbRobots);
+        set<string> names;
+        for (auto & value : lua) { names.insert(value.first); }
+        for (auto & value : native) { names.insert(value.first); }
+        for (const string & name : names) {
+            if (lua[name] != native[name]) {
+                cout << cell << " : step " << lua["step"] << ", " << name << " = " << lua[name] << " with lua, " << native[name] << " with native" << endl;
+                return false;
+            }
+        }
+    }
+    if (results[0] != results[1]) {
+        cout << cell << " : result " << results[0] << " with lua, " << results[1] << " with native" << endl;
+        return false;
+    }
+
+    if (verbose) { cout << cell << " : " << metrics[0].rows.size() << " steps identical, result " << results[0] << endl; }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (!readParameters(argc, argv)) { return 1; }
+
+    vector<string> folders = {"../runs", "../" + directory};
+    for (int i = 0; i < folders.size(); i++) {
+        if (mkdir(folders[i].c_str(), 0755) != 0 && errno != EEXIST) {
+            generateError("equivalence.cpp","main","impossible to create a folder","folder",folders[i]);
+            return 1;
+        }
+    }
+
+    int nbDifferent = 0;
+    for (int s = 0; s < scenarios.size(); s++) {
+        Scenario templates[2];
+        for (int k = 0; k < 2; k++) {
+            if (!templates[k].load("../" + templateFile(scenarios[s], controllers[k]))) { return 1; }
+        }
+        for (int r = 0; r < robots.size(); r++) {
+            for (int i = 0; i < seeds.size(); i++) {
+                bool written = true;
+                for (int k = 0; k < 2; k++) {
+                    written = written && writeScenario(&templates[k], "../" + directory + "/" + controllers[k] + ".argos", seeds[i], robots[r]);
+                }
+                if (!written || !compareCell(scenarios[s], robots[r], seeds[i])) { nbDifferent++; }
+            }
+        }
+    }
+
+    int nbCells = scenarios.size()*robots.size()*seeds.size();
+    if (verbose) { cout << "\n" << nbCells - nbDifferent << " cells identical, " << nbDifferent << " different or failed" << endl; }
+    return (nbDifferent == 0 ? 0 : 1);
+}
@@ -26,7 +26,7 @@ void generateError(string file, string method, string message, string variable,
     cerr << "\nERROR: file:" << file << ", method:" << method << ", message:" << message << ", " << variable << " = " << variableValue << endl << endl;
 }
 
-void generateError(string file, string method, string message)
+inline void generateError(string file, string method, string message)
 {
     cerr << "\nERROR: file:" << file << ", method:" << method << ", message:" << message << "." << endl << endl;
 }
@@ -9,6 +9,7 @@
 #include <vector>
 #include <fstream>
 #include <cmath>
+#include <cstdlib>
 
 #include "errors.h"
 
@@ -20,7 +21,7 @@ using namespace std;
  * @param[in] fileName Name of the file to empty
  * @return false if one error occured, true otherwise
  */
-bool emptyFile(char * fileName)
+inline bool emptyFile(char * fileName)
 {
     string const myFile(fileName);
     ofstream myInitializer(myFile.c_str());
@@ -42,7 +43,7 @@ bool emptyFile(char * fileName)
  * @param[in] message Message to append
  * @return false if one error occured, true otherwise
  */
-bool appendToFile(char * fileName, string message)
+inline bool appendToFile(char * fileName, string message)
 {
     string const myFile(fileName);
     ofstream myStream(myFile.c_str(), ios::app);
@@ -64,16 +65,22 @@ bool appendToFile(char * fileName, string message)
  * @param[in] message Message to append
  * @return false if one error occured, true otherwise
  */
-bool readFirstDouble(char * fileName, double * result)
+inline bool readFirstDouble(char * fileName, double * result)
 {
     string const myFile(fileName);
     ifstream myStream(myFile);
 
     if(myStream)
     {
+        // An empty file is the one emptied before a run that failed to write its result
         string line;
         getline(myStream, line);
-        *result = stod(line);
+        char * end;
+        *result = strtod(line.c_str(), &end);
+        if (end == line.c_str()) {
+            generateError("files.h","readFirstLine","No value in the file","file",myFile);
+            return false;
+        }
         return true;
     }
     else
@@ -83,4 +90,35 @@ bool readFirstDouble(char * fileName, double * result)
     }
 }
 
+/**
+ * Empty the file denoted by the given name and write in it one value of the vector per line,
+ * the format read by the lua controller
+ * 
+ * @param[in] fileName Name of the file to write in
+ * @param[in] x Values to write
+ * @return false if one error occured, true otherwise
+ */
+inline bool writeParameters(char * fileName, vector<double> * x)
+{
+    if (!emptyFile(fileName)) { return false; }
+    for(int param = 0; param < x->size(); param++) {
+        if (!appendToFile(fileName,to_string(x->at(param)))) { return false; }
+    }
+    return true;
+}
+
+/**
+ * Name of the template of the argos files of a scenario (see scenario.h)
+ * 
+ * @param[in] scenario Scenario of the arena, from 1 to 4
+ * @param[in] controller pso (lua script of the pso solution), native (the same controller compiled with the loop
+ * functions) or manual (lua script of the manual solution)
+ * @return path of the template, relative to the code folder
+ */
+inline string templateFile(int scenario, string controller)
+{
+    string prefix = (controller == "pso" ? "" : controller + "_");
+    return "argos_files/templates/template_" + prefix + "s" + to_string(scenario) + ".argos";
+}
+
 #endif
\ No newline at end of file
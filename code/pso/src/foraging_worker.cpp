@@ -0,0 +1,109 @@
+/*********************************************************
+ * Foraging worker : a long-lived argos simulator serving *
+ * evaluation requests on its standard input             *
+ *********************************************************/
+
+/*
+ * Usage : foraging_worker <code folder> <slot folder> <template>
+ *
+ * The slot folder (relative to the code folder) holds the parameters, result and log files of the worker.
+ * The protocol is described in worker.h : a request for another scenario, controller or objective than the ones
+ * of the template and of the environment is answered with ERROR. The argos file is rendered from the template (relative to the code
+ * folder, see scenario.h) and loaded at the first request, and again only when a request asks for another
+ * number of robots, every other request is a reset of the simulator.
+ * Nothing but the answers is written on the standard output : argos logs go to the files of the slot.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+#include "engine.h"
+#include "errors.h"
+#include "files.h"
+#include "scenario.h"
+
+using namespace std;
+
+#define NB_PARAMETERS 8 // values of a position, read by the controllers from the parameters file
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        generateError("foraging_worker.cpp","main","usage : foraging_worker <code folder> <slot folder> <template>");
+        return 1;
+    }
+    string directory = argv[1];
+    string slotDirectory = argv[2];
+    string parametersFile = slotDirectory + "/parameters.csv";
+    string scenarioFile = slotDirectory + "/scenario.argos";
+
+    Scenario scenario;
+    if (!scenario.load(directory + "/" + argv[3])) { return 1; }
+
+    // The objective is read by the loop functions in the environment inherited from PSO
+    string worker_objective = (getenv("FORAGING_OBJECTIVE") == NULL ? "objects" : getenv("FORAGING_OBJECTIVE"));
+    int worker_target = (getenv("FORAGING_TARGET_OBJECTS") == NULL ? 0 : atoi(getenv("FORAGING_TARGET_OBJECTS")));
+
+    Engine engine;
+    int loaded_robots = -1;
+
+    string line;
+    while (getline(cin, line)) {
+        istringstream request(line);
+        string command;
+        request >> command;
+
+        if (command == "QUIT") { break; }
+        if (command != "EVAL") {
+            cout << "ERROR unknown command " << command << endl;
+            continue;
+        }
+
+        int scenario_number, target, nb_robots, seed;
+        string controller, objective;
+        double value;
+        vector<double> x;
+        if (!(request >> scenario_number >> controller >> objective >> target >> nb_robots >> seed) || nb_robots <= 0) {
+            cout << "ERROR malformed request, expected EVAL <scenario> <controller> <objective> <target objects> <nb_robots> <seed> <x_1> ... <x_n>" << endl;
+            continue;
+        }
+        if (templateFile(scenario_number, controller) != argv[3] || objective != worker_objective
+            || (objective == "time" && target != worker_target)) {
+            cout << "ERROR this worker runs " << argv[3] << " with the objective " << worker_objective << endl;
+            continue;
+        }
+        while (request >> value) {
+            x.push_back(value);
+        }
+        if (x.size() != NB_PARAMETERS) {
+            cout << "ERROR " << NB_PARAMETERS << " values expected" << endl;
+            continue;
+        }
+
+        string fileName = directory + "/" + parametersFile;
+        char * cfileName = &fileName[0];
+        if (!writeParameters(cfileName, &x)) {
+            cout << "ERROR impossible to write the parameters" << endl;
+            continue;
+        }
+
+        if (nb_robots != loaded_robots) {
+            if (!scenario.write(directory + "/" + scenarioFile, seed, nb_robots)
+                || !engine.load(directory, scenarioFile, slotDirectory + "/outputArgos.csv", slotDirectory)) {
+                cout << "ERROR impossible to load the experiment for " << nb_robots << " robots" << endl;
+                loaded_robots = -1;
+                continue;
+            }
+            loaded_robots = nb_robots;
+        }
+
+        double result;
+        if (!engine.run(parametersFile, seed, &result)) {
+            cout << "ERROR experiment failed" << endl;
+            continue;
+        }
+        cout << "OK " << setprecision(17) << result << endl;
+    }
+
+    return 0;
+}
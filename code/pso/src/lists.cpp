@@ -0,0 +1,37 @@
+/**********************************************************
+ * Lists of values given on the command line of the tools *
+ *********************************************************/
+
+#include <sstream>
+#include <string>
+
+#include "lists.h"
+#include "errors.h"
+
+using namespace std;
+
+bool parseList(char * text, vector<int> * values) {
+    values->clear();
+    stringstream stream(text);
+    string item;
+
+    while (getline(stream, item, ',')) {
+        int first, last;
+        char dash;
+        istringstream range(item);
+        if (!(range >> first)) {
+            generateError("lists.cpp","parseList","malformed list","list",text);
+            return false;
+        }
+        if (range >> dash >> last) {
+            for (int value = first; value <= last; value++) {
+                values->push_back(value);
+            }
+        }
+        else {
+            values->push_back(first);
+        }
+    }
+
+    return !values->empty();
+}
@@ -0,0 +1,21 @@
+/**********************************************************
+ * Lists of values given on the command line of the tools *
+ *********************************************************/
+
+#ifndef _LISTS_H_
+#define _LISTS_H_
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Reads a list of values and ranges separated by commas, such as 1-10 or 2,13,150
+ *
+ * @param[in] text List given on the command line
+ * @param[out] values Values of the list, in order
+ * @return false if the list is empty or malformed
+ */
+bool parseList(char * text, vector<int> * values);
+
+#endif
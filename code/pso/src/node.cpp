@@ -0,0 +1,141 @@
+/************************************
+ * Implementation of the class Node *
+ ************************************/
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "node.h"
+#include "problem.h"
+#include "errors.h"
+
+using namespace std;
+
+#define CONNECTION_ATTEMPTS 30 // one per second, the coordinator may start after its nodes
+
+Node::Node(Problem * problem) {
+    m_problem = problem;
+    m_port = 0;
+}
+
+Node::~Node(){};
+
+bool Node::serve(string host, int port) {
+    m_host = host;
+    m_port = port;
+    signal(SIGPIPE, SIG_IGN);
+
+    int nb_slots = m_problem->m_nb_jobs;
+    vector<thread> threads;
+    bool * oks = new bool[nb_slots];
+    for (int slot = 0; slot < nb_slots; slot++) {
+        threads.push_back(thread(&Node::serveSlot, this, slot, &oks[slot]));
+    }
+
+    bool ok = true;
+    for (int slot = 0; slot < nb_slots; slot++) {
+        threads[slot].join();
+        ok = ok && oks[slot];
+    }
+    delete[] oks;
+    return ok;
+}
+
+// Failed runs are answered with ERROR, the coordinator decides what to do with them
+void Node::serveSlot(int slot, bool * ok) {
+    *ok = false;
+    int connection = connectToCoordinator();
+    if (connection < 0) { return; }
+
+    FILE * requests = fdopen(connection, "r");
+    FILE * answers = fdopen(dup(connection), "w");
+    if (requests == NULL || answers == NULL) {
+        generateError("node.cpp","serveSlot","impossible to use the connection","slot",slot);
+        return;
+    }
+
+    char line[4096];
+    while (fgets(line, sizeof(line), requests) != NULL) {
+        istringstream request(line);
+        string command;
+        request >> command;
+
+        if (command == "QUIT") { break; }
+        if (command != "EVAL") {
+            fprintf(answers, "ERROR unknown command %s\n", command.c_str());
+            fflush(answers);
+            continue;
+        }
+
+        int scenario, target, nb_robots, seed;
+        string controller, objective;
+        double value, result;
+        vector<double> x;
+        if (!(request >> scenario >> controller >> objective >> target >> nb_robots >> seed)) {
+            fprintf(answers, "ERROR malformed request\n");
+            fflush(answers);
+            continue;
+        }
+        while (request >> value) {
+            x.push_back(value);
+        }
+
+        // The node runs the experiment of its own options, the result would be cached under another one
+        if (scenario != m_problem->m_scenario || controller != m_problem->m_controller || objective != m_problem->m_objective
+            || (objective == "time" && target != m_problem->m_target_objects)) {
+            fprintf(answers, "ERROR this node runs the experiment %s\n", m_problem->experiment().c_str());
+        }
+        else if (nb_robots != m_problem->m_nb_robots) {
+            fprintf(answers, "ERROR this node runs %d robots\n", m_problem->m_nb_robots);
+        }
+        else if (x.size() != m_problem->getSize()) {
+            fprintf(answers, "ERROR %d values expected\n", m_problem->getSize());
+        }
+        else if (!m_problem->simulate(&x, seed, &result, slot)) {
+            fprintf(answers, "ERROR experiment failed\n");
+        }
+        else {
+            fprintf(answers, "OK %.17g\n", result);
+        }
+        fflush(answers);
+    }
+
+    fclose(requests);
+    fclose(answers);
+    *ok = true;
+}
+
+int Node::connectToCoordinator() {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    for (int attempt = 0; attempt < CONNECTION_ATTEMPTS; attempt++) {
+        struct addrinfo * addresses;
+        if (getaddrinfo(m_host.c_str(), to_string(m_port).c_str(), &hints, &addresses) == 0) {
+            for (struct addrinfo * address = addresses; address != NULL; address = address->ai_next) {
+                int connection = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+                if (connection < 0) { continue; }
+                if (connect(connection, address->ai_addr, address->ai_addrlen) == 0) {
+                    freeaddrinfo(addresses);
+                    return connection;
+                }
+                close(connection);
+            }
+            freeaddrinfo(addresses);
+        }
+        sleep(1);
+    }
+
+    generateError("node.cpp","connectToCoordinator","impossible to connect to the coordinator","host",m_host);
+    return -1;
+}
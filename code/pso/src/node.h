@@ -0,0 +1,38 @@
+/*********************************
+ * Declaration of the class Node *
+ *********************************/
+
+#ifndef NODE_H_
+#define NODE_H_
+
+#include <string>
+
+using namespace std;
+
+class Problem;
+
+/**
+ * Node of a distributed run : opens one connection to the coordinator per slot of the problem, and on each of
+ * them answers the evaluation requests of the coordinator (protocol of worker.h) with the backend of the
+ * problem. Several nodes can run on the same machine, each one works in its own folder of runs.
+ */
+class Node {
+
+public:
+
+    Problem* m_problem;
+    string m_host;
+    int m_port;
+
+    Node(Problem * problem);
+    ~Node();
+
+    bool serve(string host, int port); // Returns when the coordinator has closed every connection
+
+private:
+
+    void serveSlot(int slot, bool * ok);
+    int connectToCoordinator();
+};
+
+#endif
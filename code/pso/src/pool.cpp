@@ -0,0 +1,106 @@
+/************************************
+ * Implementation of the class Pool *
+ ************************************/
+
+#include "pool.h"
+#include "problem.h"
+
+using namespace std;
+
+Pool::Pool(Problem * problem, int nb_threads) {
+    m_problem = problem;
+    m_nb_threads = nb_threads;
+    m_pending = 0;
+    m_queue_head = 0;
+    m_done_head = 0;
+    m_stop = false;
+    for (int slot = 0; slot < m_nb_threads; slot++) {
+        m_threads.push_back(thread(&Pool::work, this, slot));
+    }
+}
+
+Pool::~Pool() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_job_available.notify_all();
+    for (int slot = 0; slot < m_nb_threads; slot++) {
+        m_threads[slot].join();
+    }
+}
+
+void Pool::reserve(int nb_jobs) {
+    lock_guard<mutex> lock(m_mutex);
+    m_queue.reserve(nb_jobs);
+    m_done.reserve(nb_jobs);
+}
+
+void Pool::submit(Job * job) {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_queue.push_back(job);
+        m_pending++;
+    }
+    m_job_available.notify_one();
+}
+
+void Pool::waitAll() {
+    unique_lock<mutex> lock(m_mutex);
+    m_job_done.wait(lock, [this] { return m_pending == 0; });
+    m_done.clear();
+    m_done_head = 0;
+}
+
+// Jobs are returned in their order of completion
+Job* Pool::waitAny() {
+    unique_lock<mutex> lock(m_mutex);
+    m_job_done.wait(lock, [this] { return m_done_head < m_done.size() || m_pending == 0; });
+    if (m_done_head == m_done.size()) { return NULL; }
+
+    Job * job = m_done[m_done_head++];
+    if (m_done_head == m_done.size()) {
+        m_done.clear();
+        m_done_head = 0;
+    }
+    return job;
+}
+
+// The jobs are written back in place, so the results keep the order of the batch whatever the order of completion
+bool Pool::run(vector<Job> * jobs) {
+    reserve(jobs->size());
+    for (int i = 0; i < jobs->size(); i++) {
+        submit(&jobs->at(i));
+    }
+    waitAll();
+
+    for (int i = 0; i < jobs->size(); i++) {
+        if (!jobs->at(i).ok) { return false; }
+    }
+    return true;
+}
+
+void Pool::work(int slot) {
+    Job * job;
+    while (true) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_job_available.wait(lock, [this] { return m_stop || m_queue_head < m_queue.size(); });
+            if (m_queue_head == m_queue.size()) { return; } // stopping and nothing left to do
+            job = m_queue[m_queue_head++];
+            if (m_queue_head == m_queue.size()) {
+                m_queue.clear();
+                m_queue_head = 0;
+            }
+        }
+
+        job->ok = m_problem->simulate(&job->x, job->seed, &job->result, slot, job->fidelity);
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_done.push_back(job);
+            m_pending--;
+        }
+        m_job_done.notify_all();
+    }
+}
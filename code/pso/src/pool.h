@@ -0,0 +1,62 @@
+/*********************************
+ * Declaration of the class Pool *
+ *********************************/
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+class Problem;
+
+// One simulation to run : a position evaluated on a single argos seed
+struct Job {
+    vector<double> x;
+    int seed;
+    double result;
+    bool ok;
+    int owner; // identifies the evaluation the run belongs to, used by the asynchronous mode
+    int fidelity; // tier of the fidelity ladder the run belongs to (FIDELITY_FULL without ladder)
+};
+
+class Pool {
+
+public:
+
+    Problem* m_problem;
+    int m_nb_threads;
+
+    vector<thread> m_threads;
+    // Vectors read from a head index and cleared once drained. Their capacity is reserved for a whole batch before
+    // it is submitted : how far they grow otherwise depends on how fast the threads drain them.
+    vector<Job*> m_queue; // jobs waiting for a free thread, from m_queue_head
+    int m_queue_head;
+    vector<Job*> m_done; // jobs finished and not yet collected by waitAny, from m_done_head
+    int m_done_head;
+    int m_pending; // jobs submitted and not finished yet
+    bool m_stop;
+
+    mutex m_mutex;
+    condition_variable m_job_available;
+    condition_variable m_job_done;
+
+    Pool(Problem* problem, int nb_threads);
+    ~Pool();
+
+    void reserve(int nb_jobs); // Capacity of the queues for nb_jobs jobs submitted at once
+    void submit(Job* job); // Queues the job, the result is written in the job itself
+    void waitAll(); // Blocks until every submitted job is finished
+    Job* waitAny(); // Blocks until one job is finished and returns it, NULL if no job is pending
+    bool run(vector<Job> * jobs); // Runs every job of the batch, false if one of them failed
+
+private:
+
+    void work(int slot); // Loop executed by each thread, slot identifies the thread
+};
+
+#endif
@@ -4,8 +4,22 @@
  ***************************************/
 
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <errno.h>
 
 #include "problem.h"
+#include "pool.h"
+#include "worker.h"
+#include "cache.h"
+#include "surrogate.h"
+#include "random.h"
+#include "coordinator.h"
+#ifdef WITH_ARGOS
+#include "engine.h"
+#endif
 #include "errors.h"
 #include "files.h"
 
@@ -13,11 +27,51 @@ using namespace std;
 
 Problem::Problem(int n, vector<double> * lower_bounds, vector<double> * upper_bounds) {
     m_n = n;
+    m_seed = 1;
     m_lower_bounds = *lower_bounds;
     m_upper_bounds = *upper_bounds;
+    m_seeds = {7,8,9};
+    m_scenario = 2;
+    m_controller = "pso";
+    m_objective = "objects";
+    m_target_objects = 0;
+    m_nb_jobs = 0;
+    m_pool = NULL;
+    m_backend = BACKEND_SHELL;
+    m_engine = NULL;
+    m_cache = NULL;
+    m_coordinator = NULL;
+    m_runs_directory = "runs";
+    m_racing = RACING_NONE;
+    m_max_result = 25;
+    m_alpha = 0.05;
+    m_nb_simulations = 0;
+    m_nb_cheap_simulations = 0;
+    m_nb_pending = 0;
+    m_surrogate = NULL;
+    m_surrogate_kappa = 0;
+    m_surrogate_min = 0;
+    m_nb_screened = 0;
+    m_ladder = false;
+    m_ladder_promote = 1;
+    m_ladder_window = 1;
+    m_ladder_length = 0;
+    m_ladder_iterations = 0;
+    m_nb_promoted = 0;
 }
 
-Problem::~Problem(){};
+Problem::~Problem(){
+    delete m_pool;
+    delete m_cache;
+    delete m_surrogate;
+    delete m_coordinator;
+    for (int slot = 0; slot < m_workers.size(); slot++) {
+        delete m_workers[slot];
+    }
+#ifdef WITH_ARGOS
+    delete m_engine;
+#endif
+};
 
 int Problem::getSize() {
     return m_n;
@@ -25,64 +79,523 @@ int Problem::getSize() {
 
 // evaluate the parameters
 bool Problem::evaluate(vector<double> * x, double * result) {
-    // Verifying preconditions
-    if (x->size() > m_n) {
-        generateError("problem.cpp","evaluate","vector x too big","x.size()",x->size());
+    if (x->size() != m_n) {
+        generateError("problem.cpp","evaluate","vector x of the wrong size","x.size()",x->size());
         return false;
     }
+    vector<const double*> xs(1, &x->at(0));
+    vector<double> results;
 
-    for (int i = 0; i < m_n; i ++) {
-        if (x->at(i) < m_lower_bounds[i] || (x->at(i) > m_upper_bounds[i])) {
-            generateError("problem.cpp","evaluate","position out of bounds","(*x)[i]",x->at(i));
-            return false;
+    if (!evaluateBatch(&xs, &results, NULL)) { return false; }
+    *result = results[0];
+
+    return true;
+}
+
+// With the fidelity ladder, every position is first evaluated on the cheap tier. The initial swarm (no thresholds)
+// is always run on the full tier too, the other positions only when their cheap evaluation is among the best promoted
+// fraction of the batch. A position left on the cheap tier is evaluated by its threshold, so it never replaces the
+// personal best of its particle.
+bool Problem::evaluateBatch(vector<const double*> * xs, vector<double> * results, vector<double> * thresholds) {
+    if (!m_ladder) { return evaluateTier(xs, results, thresholds, FIDELITY_FULL); }
+
+    vector<double> cheap;
+    if (!evaluateTier(xs, &cheap, NULL, FIDELITY_CHEAP)) { return false; }
+    m_cheap_results.insert(m_cheap_results.end(), cheap.begin(), cheap.end());
+
+    // Ties are broken by the index in the batch
+    int nbPromoted = (thresholds == NULL ? xs->size() : (int)ceil(m_ladder_promote*xs->size()));
+    vector<int> ranking(xs->size());
+    for (int i = 0; i < xs->size(); i++) {
+        ranking[i] = i;
+    }
+    stable_sort(ranking.begin(), ranking.end(), [&cheap](int a, int b) { return cheap[a] > cheap[b]; });
+    vector<bool> isPromoted(xs->size(), false);
+    for (int k = 0; k < nbPromoted; k++) {
+        isPromoted[ranking[k]] = true;
+    }
+
+    vector<const double*> promoted;
+    vector<double> promotedThresholds;
+    vector<int> origins; // index in xs of each promoted position
+    for (int i = 0; i < xs->size(); i++) {
+        if (isPromoted[i]) {
+            promoted.push_back(xs->at(i));
+            if (thresholds != NULL) { promotedThresholds.push_back(thresholds->at(i)); }
+            origins.push_back(i);
         }
     }
 
-    // write the solution inside the parameters file
-    string fileName = "../input/parameters.csv";
-    char * cfileName = &fileName[0];
-    
-    if (!emptyFile(cfileName)) { return false; }
-    for(int param = 0; param < m_n; param++) {
-        if (!appendToFile(cfileName,to_string(x->at(param)))) { return false; }
+    vector<double> full;
+    if (!promoted.empty() && !evaluateTier(&promoted, &full, thresholds == NULL ? NULL : &promotedThresholds, FIDELITY_FULL)) { return false; }
+
+    results->resize(xs->size());
+    for (int i = 0; i < xs->size(); i++) {
+        results->at(i) = (thresholds == NULL ? 0. : thresholds->at(i));
+    }
+    for (int k = 0; k < origins.size(); k++) {
+        results->at(origins[k]) = full[k];
+        m_pairs_cheap.push_back(cheap[origins[k]]);
+        m_pairs_full.push_back(full[k]);
+    }
+    m_nb_promoted += origins.size();
+    return true;
+}
+
+// Evaluates every position on one tier : argos is executed once per (position, seed) pair, all the runs of the
+// batch are given to the pool at the same time. The evaluation of a position is the mean of its results over the seeds.
+// With racing and thresholds (the personal best of each particle), the seeds are run one round at a time and a
+// position stops as soon as it can't beat its threshold anymore : its evaluation is then the mean of its first runs.
+bool Problem::evaluateTier(vector<const double*> * xs, vector<double> * results, vector<double> * thresholds, int fidelity) {
+    vector<int> & seeds = tierSeeds(fidelity);
+    int nbRuns = seeds.size();
+    vector<Job> & jobs = m_batch;
+    vector<int> & done = m_batch_done; // number of seeds run for each position
+    jobs.resize(xs->size()*nbRuns);
+    done.assign(xs->size(), 0);
+
+    for (int i = 0; i < xs->size(); i++) {
+        if (!checkPosition(xs->at(i))) { return false; }
+        for (int run = 0; run < nbRuns; run++) {
+            jobs[i*nbRuns + run].x.assign(xs->at(i), xs->at(i) + m_n);
+            jobs[i*nbRuns + run].seed = seeds[run];
+            jobs[i*nbRuns + run].fidelity = fidelity;
+        }
+    }
+
+    if (thresholds == NULL || m_racing == RACING_NONE) {
+        if (!runJobs(&jobs)) { return false; }
+        done.assign(xs->size(), nbRuns);
+    }
+    else {
+        vector<Job> & round = m_round;
+        vector<int> & positions = m_round_positions; // position of each job of the round
+
+        for (int run = 0; run < nbRuns; run++) {
+            positions.clear();
+            for (int i = 0; i < xs->size(); i++) {
+                if (done[i] == run && (run == 0 || canStillBeat(&jobs[i*nbRuns], run, thresholds->at(i)))) {
+                    positions.push_back(i);
+                }
+            }
+            if (positions.empty()) { break; }
+
+            round.resize(positions.size());
+            for (int k = 0; k < positions.size(); k++) {
+                round[k] = jobs[positions[k]*nbRuns + run];
+            }
+            if (!runJobs(&round)) { return false; }
+            for (int k = 0; k < round.size(); k++) {
+                jobs[positions[k]*nbRuns + run] = round[k];
+                done[positions[k]]++;
+            }
+        }
     }
 
-    // Evaluation loop : argos is executed 3 times with 3 different seeds, the evaluation is the mean of the three results.
-    int nbRuns = 3;
+    // Jobs are stored in submission order, so the sums are always done in the same order
+    results->resize(xs->size());
+    for (int i = 0; i < xs->size(); i++) {
+        double sumResults = 0.;
+        for (int run = 0; run < done[i]; run++) {
+            sumResults += jobs[i*nbRuns + run].result;
+        }
+        results->at(i) = sumResults/(double)done[i];
+        if (m_surrogate != NULL && fidelity == FIDELITY_FULL) { m_surrogate->add(&jobs[i*nbRuns].x, results->at(i)); }
+    }
+
+    return true;
+}
+
+// Racing test on the first runs of a position : true if the mean over all the seeds could still be above the
+// threshold. The bound test assumes the best possible result for the missing runs, the t-test uses the upper
+// bound of the one-sided confidence interval of the mean (it needs two runs, before that the bound test is used).
+bool Problem::canStillBeat(Job * runs, int nbDone, double threshold) {
+    int nbRuns = m_seeds.size();
+    if (nbDone >= nbRuns) { return false; }
+    if (m_racing == RACING_NONE) { return true; }
+
+    double sum = 0.;
+    for (int run = 0; run < nbDone; run++) {
+        sum += runs[run].result;
+    }
+
+    if (m_racing == RACING_BOUND || nbDone < 2) {
+        return (sum + (nbRuns - nbDone)*m_max_result)/(double)nbRuns > threshold;
+    }
+
+    double mean = sum/(double)nbDone;
+    double variance = 0.;
+    for (int run = 0; run < nbDone; run++) {
+        variance += (runs[run].result - mean)*(runs[run].result - mean);
+    }
+    variance /= (double)(nbDone - 1);
+
+    return mean + studentQuantile(nbDone - 1)*sqrt(variance/(double)nbDone) > threshold;
+}
+
+// One-sided quantiles of the Student distribution for the confidence levels accepted by set_racing
+double Problem::studentQuantile(int degrees) {
+    static const double quantiles[3][10] = {
+        {3.078, 1.886, 1.638, 1.533, 1.476, 1.440, 1.415, 1.397, 1.383, 1.372}, // alpha = 0.10
+        {6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812}, // alpha = 0.05
+        {31.821, 6.965, 4.541, 3.747, 3.365, 3.143, 2.998, 2.896, 2.821, 2.764} // alpha = 0.01
+    };
+    static const double normal[3] = {1.282, 1.645, 2.326}; // more than 10 degrees of freedom
+
+    int level = (m_alpha == 0.10 ? 0 : (m_alpha == 0.05 ? 1 : 2));
+    if (degrees > 10) { return normal[level]; }
+    return quantiles[level][degrees - 1];
+}
+
+// The runs found in the cache are done immediately, the other ones go to the pool.
+// With racing the seeds are submitted one at a time, with the ladder the cheap tier comes first, see advanceEvaluation.
+bool Problem::submitEvaluation(int id, const double * x, double threshold) {
+    if (!checkPosition(x)) { return false; }
+
+    Evaluation & evaluation = m_evaluations[id];
+    m_nb_pending++;
+    m_pool->reserve(m_evaluations.size()*m_seeds.size());
+    evaluation.threshold = threshold;
+    prepareJobs(&evaluation, id, x, m_ladder ? FIDELITY_CHEAP : FIDELITY_FULL);
+
+    advanceEvaluation(id);
+    return true;
+}
+
+// One job per seed of the tier, none submitted yet
+void Problem::prepareJobs(Evaluation * evaluation, int id, const double * x, int fidelity) {
+    vector<int> & seeds = tierSeeds(fidelity);
+    evaluation->jobs.resize(seeds.size());
+    evaluation->remaining = 0;
+    evaluation->submitted = 0;
+    evaluation->fidelity = fidelity;
+
+    for (int run = 0; run < seeds.size(); run++) {
+        evaluation->jobs[run].x.assign(x, x + m_n);
+        evaluation->jobs[run].seed = seeds[run];
+        evaluation->jobs[run].owner = id;
+        evaluation->jobs[run].fidelity = fidelity;
+    }
+}
+
+// Called when no run of the evaluation is running : submits its next runs, or marks it as ready if all the
+// seeds are done, if the racing test stops it or if its cheap evaluation isn't promoted
+void Problem::advanceEvaluation(int id) {
+    Evaluation & evaluation = m_evaluations[id];
+
+    while (evaluation.remaining == 0) {
+        int nbRuns = evaluation.jobs.size();
+        if (evaluation.fidelity == FIDELITY_CHEAP && evaluation.submitted == nbRuns) {
+            double sumResults = 0.;
+            for (int run = 0; run < nbRuns; run++) {
+                sumResults += evaluation.jobs[run].result;
+            }
+            evaluation.cheap = sumResults/(double)nbRuns;
+            if (!promote(evaluation.cheap)) {
+                m_ready.push_back(id);
+                return;
+            }
+            vector<double> x = evaluation.jobs[0].x;
+            prepareJobs(&evaluation, id, &x[0], FIDELITY_FULL);
+            nbRuns = evaluation.jobs.size();
+        }
+        else if (evaluation.fidelity == FIDELITY_FULL && evaluation.submitted > 0
+                 && !canStillBeat(&evaluation.jobs[0], evaluation.submitted, evaluation.threshold)) {
+            m_ready.push_back(id);
+            return;
+        }
+
+        int last = (m_racing == RACING_NONE || evaluation.fidelity == FIDELITY_CHEAP ? nbRuns : evaluation.submitted + 1);
+        for (int run = evaluation.submitted; run < last; run++) {
+            Job * job = &evaluation.jobs[run];
+            job->ok = (m_cache != NULL && m_cache->find(scenarioName(job->fidelity), job->seed, &job->x, &job->result));
+            if (!job->ok) {
+                evaluation.remaining++;
+                m_nb_simulations++;
+                if (job->fidelity == FIDELITY_CHEAP) { m_nb_cheap_simulations++; }
+                m_pool->submit(job);
+            }
+        }
+        evaluation.submitted = last;
+    }
+}
+
+// The result is the mean over the seeds run, summed in the order of the seeds whatever the order of completion
+bool Problem::waitEvaluation(int * id, double * result) {
+    while (m_ready.empty()) {
+        Job * job = m_pool->waitAny();
+        if (job == NULL) {
+            generateError("problem.cpp","waitEvaluation","no evaluation pending");
+            return false;
+        }
+        if (!job->ok) { return false; }
+        if (m_cache != NULL && !m_cache->store(scenarioName(job->fidelity), job->seed, &job->x, job->result)) { return false; }
+
+        Evaluation & evaluation = m_evaluations[job->owner];
+        evaluation.remaining--;
+        if (evaluation.remaining == 0) {
+            advanceEvaluation(job->owner);
+        }
+    }
+
+    *id = m_ready.front();
+    m_ready.pop_front();
+
+    Evaluation & evaluation = m_evaluations[*id];
+    m_nb_pending--; // the entry is kept, its jobs are reused by the next evaluation with the same identifier
+
+    // A position left on the cheap tier can't replace the personal best
+    if (evaluation.fidelity == FIDELITY_CHEAP) {
+        *result = evaluation.threshold;
+        return true;
+    }
 
-    double resultBuffer = 0.;
     double sumResults = 0.;
+    for (int run = 0; run < evaluation.submitted; run++) {
+        sumResults += evaluation.jobs[run].result;
+    }
+    *result = sumResults/(double)evaluation.submitted;
+    if (m_surrogate != NULL) { m_surrogate->add(&evaluation.jobs[0].x, *result); }
+    if (m_ladder) {
+        m_pairs_cheap.push_back(evaluation.cheap);
+        m_pairs_full.push_back(*result);
+        m_nb_promoted++;
+    }
 
-    // Files where the number of objets in nest will be located
-    fileName = "../output/outputArgos.csv";
-    cfileName = &fileName[0];
+    return true;
+}
+
+int Problem::pendingEvaluations() {
+    return m_nb_pending;
+}
 
-    // Argos seeds
-    vector<int> seeds = {7,8,9};
+// Asynchronous mode : a cheap evaluation is promoted when less than the promoted fraction of the last m_ladder_window
+// cheap evaluations, itself included, are strictly better. Ranking it against the whole history would promote most
+// positions while the swarm improves.
+bool Problem::promote(double cheap) {
+    m_cheap_results.push_back(cheap);
 
-    // Commands for executing argos
-    string command_line = "cd .. && argos3 -n -l INFOFILE -e ERRORFILE -c argos_files/configured_scenarios/foraging_s2_" + to_string(m_nb_robots) + "_";
-    string command_line_buffer;
-    char * char_command_line;
+    int first = max(0, (int)m_cheap_results.size() - m_ladder_window);
+    int nbBetter = 0;
+    for (int k = first; k < m_cheap_results.size(); k++) {
+        if (m_cheap_results[k] > cheap) { nbBetter++; }
+    }
+    return nbBetter < m_ladder_promote*(double)(m_cheap_results.size() - first);
+}
 
-    for (int run = 0; run < nbRuns; run ++) {
-        command_line_buffer = command_line + to_string(seeds[run]) + ".argos";
-        char_command_line = &command_line_buffer[0];
+vector<int> & Problem::tierSeeds(int fidelity) {
+    return (fidelity == FIDELITY_CHEAP ? m_cheap_seeds : m_seeds);
+}
 
-        // Launch argos
-        auto res = system(char_command_line);
-        // Read number of objects in nest
-        if (!readFirstDouble(cfileName,&resultBuffer)) { return false; }
+// Spearman coefficient : correlation of the ranks, tied values sharing their mean rank. 1 when the cheap tier
+// orders the positions exactly as the full one. The pairs are the positions promoted, the initial swarm included.
+double Problem::ladderCorrelation() {
+    int nbPairs = m_pairs_full.size();
+    if (nbPairs < 2) { return 0.; }
 
-        sumResults += resultBuffer;
+    vector<double> * values[2] = {&m_pairs_cheap, &m_pairs_full};
+    vector<double> ranks[2];
+    for (int tier = 0; tier < 2; tier++) {
+        ranks[tier].resize(nbPairs);
+        for (int i = 0; i < nbPairs; i++) {
+            int nbBelow = 0, nbEqual = 0;
+            for (int j = 0; j < nbPairs; j++) {
+                if (values[tier]->at(j) < values[tier]->at(i)) { nbBelow++; }
+                else if (values[tier]->at(j) == values[tier]->at(i)) { nbEqual++; }
+            }
+            ranks[tier][i] = nbBelow + (nbEqual + 1)/2.;
+        }
+    }
+
+    double mean = (nbPairs + 1)/2.;
+    double covariance = 0., variance0 = 0., variance1 = 0.;
+    for (int i = 0; i < nbPairs; i++) {
+        covariance += (ranks[0][i] - mean)*(ranks[1][i] - mean);
+        variance0 += (ranks[0][i] - mean)*(ranks[0][i] - mean);
+        variance1 += (ranks[1][i] - mean)*(ranks[1][i] - mean);
+    }
+    if (variance0 == 0. || variance1 == 0.) { return 0.; }
+    return covariance/sqrt(variance0*variance1);
+}
+
+// Always false until the surrogate has been trained on enough evaluations
+bool Problem::isClearlyWorse(const double * x, double threshold) {
+    if (m_surrogate == NULL || m_surrogate->size() < m_surrogate_min) { return false; }
+
+    double mean, deviation;
+    if (!m_surrogate->predict(x, &mean, &deviation)) { return false; }
+    if (mean + m_surrogate_kappa*deviation < threshold) {
+        m_nb_screened++;
+        return true;
+    }
+    return false;
+}
+
+// Runs the jobs with the pool, except the ones already in the cache. The results are written in the jobs.
+// Without cache the jobs are given to the pool in place.
+bool Problem::runJobs(vector<Job> * jobs) {
+    if (m_cache == NULL) {
+        m_nb_simulations += jobs->size();
+        if (!jobs->empty() && jobs->at(0).fidelity == FIDELITY_CHEAP) { m_nb_cheap_simulations += jobs->size(); }
+        return m_pool->run(jobs);
+    }
+
+    vector<Job> runs;
+    vector<int> origins; // index in jobs of each run
+
+    for (int k = 0; k < jobs->size(); k++) {
+        Job * job = &jobs->at(k);
+        job->ok = (m_cache != NULL && m_cache->find(scenarioName(job->fidelity), job->seed, &job->x, &job->result));
+        if (!job->ok) {
+            runs.push_back(*job);
+            origins.push_back(k);
+        }
+    }
+
+    m_nb_simulations += runs.size();
+    if (!runs.empty() && runs[0].fidelity == FIDELITY_CHEAP) { m_nb_cheap_simulations += runs.size(); }
+    if (!m_pool->run(&runs)) { return false; }
+
+    for (int r = 0; r < runs.size(); r++) {
+        jobs->at(origins[r]) = runs[r];
+        if (m_cache != NULL && !m_cache->store(scenarioName(runs[r].fidelity), runs[r].seed, &runs[r].x, runs[r].result)) { return false; }
+    }
+
+    return true;
+}
+
+// Name of the scenario in the cache, runs of different scenarios or tiers are never mixed. Neither are the
+// backends giving different results for the same seed : the engine and the workers reset a loaded simulator, which
+// puts the objects back where they were drawn at load time, and the remote nodes may run either kind of backend.
+string Problem::scenarioName(int fidelity) {
+    string cheap = "_cheap_" + to_string(m_ladder_length) + "_" + to_string(m_ladder_iterations);
+    if (m_backend == BACKEND_ANALYTIC) { return (fidelity == FIDELITY_CHEAP ? "analytic_cheap" : "analytic"); }
+    string name = "s" + to_string(m_scenario) + "_" + to_string(m_nb_robots);
+    if (m_controller == "native") { name += "_native"; }
+    if (m_backend == BACKEND_ENGINE || m_backend == BACKEND_WORKERS) { name += "_reset"; }
+    if (m_backend == BACKEND_REMOTE) { name += "_remote"; }
+    if (fidelity == FIDELITY_CHEAP) { name += cheap; }
+    if (m_objective == "time") { return name + "_time_" + to_string(m_target_objects); }
+    if (m_objective != "objects") { return name + "_" + m_objective; }
+    return name;
+}
+
+// Scenario, controller, objective and target objects, as sent to the workers and nodes (see worker.h)
+string Problem::experiment() {
+    return to_string(m_scenario) + " " + m_controller + " " + m_objective + " " + to_string(m_target_objects);
+}
+
+// Runs one experiment with the backend of the problem, on the slot of the calling thread
+bool Problem::simulate(vector<double> * x, int seed, double * result, int slot, int fidelity) {
+    if (m_backend == BACKEND_ENGINE) {
+        return runEngine(x, seed, result, slot);
+    }
+    if (m_backend == BACKEND_WORKERS) {
+        return runWorker(x, seed, result, slot);
+    }
+    if (m_backend == BACKEND_ANALYTIC) {
+        return runAnalytic(x, seed, result, fidelity);
+    }
+    if (m_backend == BACKEND_REMOTE) {
+        return runRemote(x, seed, result);
+    }
+    return runShell(x, seed, result, slot, fidelity);
+}
+
+// Launches argos3. The parameters and the result of the run are exchanged through files owned by the slot,
+// their paths are given to the lua controller and the loop functions through the environment.
+bool Problem::runShell(vector<double> * x, int seed, double * result, int slot, int fidelity) {
+    string directory = slotDirectory(slot);
+    string parametersFile = directory + "/parameters.csv";
+    string outputFile = directory + "/outputArgos.csv";
+
+    // write the solution inside the parameters file
+    string fileName = "../" + parametersFile;
+    char * cfileName = &fileName[0];
+    if (!writeParameters(cfileName, x)) { return false; }
+
+    // A result left by a previous run of the slot must not be read if argos fails
+    string resultFile = "../" + outputFile;
+    char * cresultFile = &resultFile[0];
+    if (!emptyFile(cresultFile)) { return false; }
+
+    // Command for executing argos
+    string command_line = "cd .. && FORAGING_PARAMETERS=" + parametersFile + " FORAGING_OUTPUT=" + outputFile
+                        + " argos3 -n -l " + directory + "/INFOFILE -e " + directory + "/ERRORFILE"
+                        + " -c " + scenarioFile(slot, seed, fidelity);
+    char * char_command_line = &command_line[0];
+
+    // Launch argos
+    int status = system(char_command_line);
+    if (status != 0) {
+        generateError("problem.cpp","runShell","argos3 failed, see " + directory + "/ERRORFILE","status",status);
+        return false;
     }
 
-    // Computes the mean of the three results
-    *result = sumResults/(double)nbRuns;
+    // Read number of objects in nest
+    if (!readFirstDouble(cresultFile,result)) { return false; }
 
     return true;
 }
 
+// Runs the experiment in the simulator of the process. The argos file is loaded at the first run only,
+// the seed of the file doesn't matter since every run resets the simulator with its own seed.
+bool Problem::runEngine(vector<double> * x, int seed, double * result, int slot) {
+#ifdef WITH_ARGOS
+    string directory = slotDirectory(slot);
+    string fileName = "../" + directory + "/parameters.csv";
+    char * cfileName = &fileName[0];
+    if (!writeParameters(cfileName, x)) { return false; }
+
+    if (m_engine == NULL) {
+        m_engine = new Engine();
+        if (!m_engine->load("..", scenarioFile(slot, m_seeds[0], FIDELITY_FULL), directory + "/outputArgos.csv", directory)) { return false; }
+    }
+    return m_engine->run(directory + "/parameters.csv", seed, result);
+#else
+    generateError("problem.cpp","runEngine","the engine backend needs PSO to be compiled with ARGOS=1");
+    return false;
+#endif
+}
+
+// Sends the run to the worker process of the slot, the worker is started at the first run. A worker that died
+// during the run is started again and the run is tried once more on it.
+bool Problem::runWorker(vector<double> * x, int seed, double * result, int slot) {
+    Worker * worker = m_workers[slot];
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!worker->m_started) {
+            if (!worker->start("./foraging_worker", "..", slotDirectory(slot), templateFile(m_scenario, m_controller))) { return false; }
+        }
+        if (worker->evaluate(x, experiment(), m_nb_robots, seed, result)) { return true; }
+        if (worker->m_started) { return false; } // the worker answered ERROR
+    }
+    return false;
+}
+
+// Number of objects a foraging run could bring back : a smooth peak in the middle of the search space, at most
+// 25 objects, with a noise depending on the seed. It only stands in for argos when measuring PSO itself.
+// The cheap tier adds a larger noise depending on the position, as a shorter and coarser simulation would.
+bool Problem::runAnalytic(vector<double> * x, int seed, double * result, int fidelity) {
+    double distance2 = 0.;
+    for (int i = 0; i < m_n; i++) {
+        double relative = (x->at(i) - m_lower_bounds[i])/(m_upper_bounds[i] - m_lower_bounds[i]) - 0.6;
+        distance2 += relative*relative;
+    }
+    double noise = 0.5*sin(seed*12.9898 + x->at(0)*78.233);
+    if (fidelity == FIDELITY_CHEAP) { noise += 2.*sin(seed*4.1414 + x->at(1)*37.719); }
+    *result = max(0., 24.*exp(-4.*distance2) + noise);
+    return true;
+}
+
+// Sends the run to an idle node. The slot doesn't matter : the nodes have their own folders.
+bool Problem::runRemote(vector<double> * x, int seed, double * result) {
+    if (m_coordinator == NULL) {
+        generateError("problem.cpp","runRemote","the remote backend needs a port to listen to");
+        return false;
+    }
+    return m_coordinator->evaluate(x, experiment(), m_nb_robots, seed, result);
+}
+
 // Stores the final global best evaluation in the output file. Used during the tunning.
 bool Problem::storeResult(double result) {
     string fileName = "../output/outputPSO.csv";
@@ -124,16 +637,259 @@ double Problem::getUpperBound(int feature) {
     return m_upper_bounds[feature];
 }
 
-double Problem::getRandomX(int feature){
-	double randomDouble = ((double) rand()/RAND_MAX) * (m_upper_bounds[feature]-m_lower_bounds[feature]) + m_lower_bounds[feature];
+void Problem::set_seed(int seed) {
+    m_seed = seed;
+}
+
+double Problem::getRandom01(int stream, uint64_t * counter) {
+    return philoxUniform(m_seed, stream, (*counter)++);
+}
+
+double Problem::getRandomX(int feature, int stream, uint64_t * counter){
+	double randomDouble = getRandom01(stream, counter) * (m_upper_bounds[feature]-m_lower_bounds[feature]) + m_lower_bounds[feature];
 	return(randomDouble);
 };
 
-double Problem::getRandomV(int feature){
-	double randomDouble = ((double) rand()/RAND_MAX) * 2*(m_upper_bounds[feature]-m_lower_bounds[feature]) - m_upper_bounds[feature];
+double Problem::getRandomV(int feature, int stream, uint64_t * counter){
+	double randomDouble = getRandom01(stream, counter) * 2*(m_upper_bounds[feature]-m_lower_bounds[feature]) - m_upper_bounds[feature];
 	return(randomDouble);
 };
 
 void Problem::set_nb_robots(int nb_robots) {
     m_nb_robots = nb_robots;
-}
\ No newline at end of file
+}
+
+// The seeds of the argos runs are 7, 8, 9... whatever their number
+bool Problem::set_nb_seeds(int nbSeeds) {
+    if (nbSeeds < 1) {
+        generateError("problem.cpp","set_nb_seeds","at least one seed is needed","nb_seeds",nbSeeds);
+        return false;
+    }
+    m_seeds.clear();
+    for (int run = 0; run < nbSeeds; run++) {
+        m_seeds.push_back(7 + run);
+    }
+    return true;
+}
+
+bool Problem::set_nb_jobs(int nb_jobs) {
+    if (nb_jobs < 1) {
+        generateError("problem.cpp","set_nb_jobs","at least one job is needed","nb_jobs",nb_jobs);
+        return false;
+    }
+    if (m_backend == BACKEND_ENGINE && nb_jobs > 1) {
+        generateError("problem.cpp","set_nb_jobs","the engine backend runs one simulation at a time","nb_jobs",nb_jobs);
+        return false;
+    }
+
+    for (int slot = 0; slot < nb_jobs; slot++) {
+        if (!prepareSlot(slot)) { return false; }
+    }
+
+    for (int slot = m_workers.size(); slot < nb_jobs; slot++) {
+        m_workers.push_back(new Worker());
+    }
+
+    delete m_pool;
+    m_nb_jobs = nb_jobs;
+    m_pool = new Pool(this, m_nb_jobs);
+    return true;
+}
+
+bool Problem::set_backend(int backend) {
+#ifndef WITH_ARGOS
+    if (backend == BACKEND_ENGINE) {
+        generateError("problem.cpp","set_backend","the engine backend needs PSO to be compiled with ARGOS=1");
+        return false;
+    }
+#endif
+    m_backend = backend;
+    return true;
+}
+
+// maxResult is the best possible result of one run, used by the bound test (0 : the one of the objective).
+// alpha is the risk of the t-test, one of 0.10, 0.05 and 0.01.
+bool Problem::set_racing(int racing, double maxResult, double alpha) {
+    if (alpha != 0.10 && alpha != 0.05 && alpha != 0.01) {
+        generateError("problem.cpp","set_racing","alpha must be 0.10, 0.05 or 0.01","alpha",alpha);
+        return false;
+    }
+    // With 3 seeds the t-test is only done after 2 runs, with 1 degree of freedom : its quantile is so large that it
+    // never drops a particle
+    if (racing == RACING_TTEST && m_seeds.size() < 4) {
+        generateError("problem.cpp","set_racing","the t-test needs at least 4 seeds","nb_seeds",(int)m_seeds.size());
+        return false;
+    }
+
+    // The bound must be the best result of one run : 25 objects for objects and auc, the length of the experiment
+    // for time. The analytic backend keeps its own range whatever the objective.
+    double bestResult = 25;
+    if (m_objective == "time" && m_backend != BACKEND_ANALYTIC) {
+        bestResult = 0;
+        if (m_template.m_template_file != "" && !m_template.length(&bestResult)) { return false; }
+    }
+    if (maxResult <= 0) {
+        if (racing != RACING_NONE && bestResult <= 0) {
+            generateError("problem.cpp","set_racing","the length of the experiment is unknown here, the time objective needs the racing max","backend",m_backend);
+            return false;
+        }
+        maxResult = bestResult;
+    }
+    if (racing != RACING_NONE && maxResult < bestResult) {
+        generateError("problem.cpp","set_racing","the racing max is below the best result of the objective","max_result",maxResult);
+        return false;
+    }
+
+    m_racing = racing;
+    m_max_result = maxResult;
+    m_alpha = alpha;
+    return true;
+}
+
+// kappa is the number of standard deviations of the prediction kept as a safety margin, the model is trained
+// on the last maxSamples evaluations
+bool Problem::set_surrogate(double kappa, int minSamples, int maxSamples) {
+    if (minSamples < 2 || maxSamples < minSamples) {
+        generateError("problem.cpp","set_surrogate","the surrogate needs at least 2 samples, and no more than its maximum","min_samples",minSamples);
+        return false;
+    }
+    m_surrogate = new Surrogate(&m_lower_bounds, &m_upper_bounds, maxSamples);
+    m_surrogate_kappa = kappa;
+    m_surrogate_min = minSamples;
+    return true;
+}
+
+// The cheap tier runs the experiments for length seconds with iterations physics steps per step (0 : those of
+// the template) on the first nbSeeds seeds. promote is the fraction of the cheap evaluations run on the full tier :
+// the best ones of each batch, or of the last window evaluations in the asynchronous mode.
+// The workers, the engine and the nodes run the argos file they loaded, only the shell and analytic backends can
+// change the fidelity of a run.
+bool Problem::set_ladder(double promote, int length, int iterations, int nbSeeds, int window) {
+    if (m_backend != BACKEND_SHELL && m_backend != BACKEND_ANALYTIC) {
+        generateError("problem.cpp","set_ladder","the fidelity ladder needs the shell or analytic backend","backend",m_backend);
+        return false;
+    }
+    if (promote <= 0 || promote > 1) {
+        generateError("problem.cpp","set_ladder","the promoted fraction must be in (0,1]","promote",promote);
+        return false;
+    }
+    if (nbSeeds < 1 || nbSeeds > m_seeds.size()) {
+        generateError("problem.cpp","set_ladder","the cheap tier needs between 1 and all the seeds","nb_seeds",nbSeeds);
+        return false;
+    }
+    m_ladder = true;
+    m_ladder_promote = promote;
+    m_ladder_window = max(1, window);
+    m_ladder_length = length;
+    m_ladder_iterations = iterations;
+    m_cheap_seeds.assign(m_seeds.begin(), m_seeds.begin() + nbSeeds);
+    if (m_template.m_template_file == "") { return true; }
+
+    m_cheap_template = m_template;
+    return m_cheap_template.setFidelity(length, iterations);
+}
+
+// timeout is the number of seconds a node can stay silent before its run is sent to another one (0 : no limit)
+bool Problem::set_remote(int port, double timeout) {
+    m_coordinator = new Coordinator();
+    return m_coordinator->listen(port, timeout);
+}
+
+// The analytic and remote backends run no argos file here, they don't need the template
+bool Problem::set_scenario(int scenario, string controller) {
+    if (controller != "pso" && controller != "native") {
+        generateError("problem.cpp","set_scenario","unknown controller, expected pso or native","controller",controller);
+        return false;
+    }
+    m_scenario = scenario;
+    m_controller = controller;
+    if (m_backend == BACKEND_ANALYTIC || m_backend == BACKEND_REMOTE) { return true; }
+    return m_template.load("../" + templateFile(scenario, controller));
+}
+
+// The loop functions read the objective in the environment, inherited by the argos3 commands and the workers
+// and read directly by the engine. The default objective keeps the environment untouched.
+bool Problem::set_objective(string objective, int targetObjects) {
+    if (objective != "objects" && objective != "auc" && objective != "time") {
+        generateError("problem.cpp","set_objective","unknown objective, expected objects, auc or time","objective",objective);
+        return false;
+    }
+    m_objective = objective;
+    m_target_objects = targetObjects;
+    if (objective == "objects") { return true; }
+
+    setenv("FORAGING_OBJECTIVE", objective.c_str(), 1);
+    setenv("FORAGING_TARGET_OBJECTS", to_string(targetObjects).c_str(), 1);
+    return true;
+}
+
+// Several PSO processes sharing a code folder (the nodes of a distributed run) must use different folders
+void Problem::set_runs_directory(string directory) {
+    m_runs_directory = directory;
+}
+
+// The tolerance is a fraction of the range of each feature : two positions closer than it on every feature
+// share their results. 0 keeps the exact positions.
+bool Problem::set_cache(string fileName, double tolerance) {
+    if (tolerance < 0) {
+        generateError("problem.cpp","set_cache","the tolerance can't be negative","tolerance",tolerance);
+        return false;
+    }
+
+    vector<double> steps(m_n);
+    for (int i = 0; i < m_n; i++) {
+        steps[i] = tolerance*(m_upper_bounds[i]-m_lower_bounds[i]);
+    }
+
+    delete m_cache;
+    m_cache = new Cache();
+    return m_cache->load(fileName, &steps);
+}
+
+// Verifying preconditions on a position before evaluating it
+bool Problem::checkPosition(const double * x) {
+    for (int i = 0; i < m_n; i ++) {
+        if (x[i] < m_lower_bounds[i] || (x[i] > m_upper_bounds[i])) {
+            generateError("problem.cpp","evaluate","position out of bounds","(*x)[i]",x[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Paths of the slot files are relative to the code folder, where argos is launched
+string Problem::slotDirectory(int slot) {
+    return m_runs_directory + "/slot_" + to_string(slot);
+}
+
+bool Problem::prepareSlot(int slot) {
+    vector<string> folders = {"../runs", "../" + m_runs_directory, "../" + slotDirectory(slot)};
+
+    for (int i = 0; i < folders.size(); i++) {
+        if (mkdir(folders[i].c_str(), 0755) != 0 && errno != EEXIST) {
+            generateError("problem.cpp","prepareSlot","impossible to create a folder","folder",folders[i]);
+            return false;
+        }
+    }
+
+    // The argos files of the runs are rendered once per seed, for the robots of the problem, so any number of
+    // robots and any seed can be used and the runs themselves write no argos file
+    if (m_template.m_template_file != "") {
+        for (int run = 0; run < m_seeds.size(); run++) {
+            if (!m_template.write("../" + scenarioFile(slot, m_seeds[run], FIDELITY_FULL), m_seeds[run], m_nb_robots)) { return false; }
+        }
+    }
+    if (m_ladder && m_cheap_template.m_template_file != "") {
+        for (int run = 0; run < m_cheap_seeds.size(); run++) {
+            if (!m_cheap_template.write("../" + scenarioFile(slot, m_cheap_seeds[run], FIDELITY_CHEAP), m_cheap_seeds[run], m_nb_robots)) { return false; }
+        }
+    }
+
+    return true;
+}
+
+// Argos file of the slot for the given seed and tier, relative to the code folder
+string Problem::scenarioFile(int slot, int seed, int fidelity) {
+    return slotDirectory(slot) + (fidelity == FIDELITY_CHEAP ? "/scenario_cheap_" : "/scenario_") + to_string(seed) + ".argos";
+}
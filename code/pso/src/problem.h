@@ -7,17 +7,95 @@
 #define PROBLEM_H_
 
 #include <vector>
+#include <string>
+#include <cstdint>
+#include <map>
+#include <deque>
+
+#include "pool.h"
+#include "scenario.h"
 
 using namespace std;
 
+#define BACKEND_SHELL 0 // one argos3 process per run
+#define BACKEND_ENGINE 1 // argos simulator linked in the PSO process (needs to be compiled with ARGOS=1)
+#define BACKEND_WORKERS 2 // one long-lived foraging_worker process per slot (see foraging_worker.cpp)
+#define BACKEND_ANALYTIC 3 // benchmarking stub : a cheap function of the position instead of argos, to measure the cost of PSO itself
+#define BACKEND_REMOTE 4 // runs sent to the PSO nodes connected to the coordinator (see coordinator.h)
+
+#define RACING_NONE 0 // every position is run on all the seeds
+#define RACING_BOUND 1 // stop when even the best possible results on the missing seeds can't beat the threshold
+#define RACING_TTEST 2 // stop when the one-sided confidence interval of the mean is below the threshold
+
+#define FIDELITY_FULL 0 // the argos files of the scenario, on every seed
+#define FIDELITY_CHEAP 1 // shorter experiments, coarser physics and fewer seeds, screening the positions of the ladder
+
+class Engine;
+class Worker;
+class Cache;
+class Surrogate;
+class Coordinator;
+
+// Runs of a position submitted in the asynchronous mode
+struct Evaluation {
+    vector<Job> jobs; // one per seed
+    int submitted; // runs submitted so far, the first ones of jobs
+    int remaining; // runs submitted and not finished yet
+    double threshold; // result the position must be able to beat to keep racing
+    int fidelity; // tier of the runs in jobs, the cheap one first with the fidelity ladder
+    double cheap; // evaluation on the cheap tier, once it is done
+};
+
 class Problem {
 
 public :
 
     int m_n; // number of variables
     int m_nb_robots; // number of robots (used during the early experimentations, now we always use 13 robots)
+    int m_scenario; // scenario of the arena, from 1 to 4 (PSO was tuned on the scenario 2)
+    string m_controller; // pso (lua script) or native (the same controller compiled with the loop functions)
+    Scenario m_template; // argos files of the scenario, rendered for the robots and seeds of the problem
+    string m_objective; // result of a run computed by the loop functions : objects, auc or time
+    int m_target_objects; // objects the time objective waits for, 0 for all of them
     vector<double> m_lower_bounds;
     vector<double> m_upper_bounds;
+    vector<int> m_seeds; // argos seeds, an evaluation is the mean of one run per seed
+    int m_nb_jobs; // number of simulations executed at the same time
+    Pool* m_pool;
+    int m_backend; // how the simulations are executed
+    Engine* m_engine;
+    vector<Worker*> m_workers; // one per slot, started at their first run
+    Cache* m_cache; // results of the runs already done, NULL when the cache isn't used
+    Coordinator* m_coordinator; // connections to the nodes, NULL unless the backend is remote
+    string m_runs_directory; // folder of the slots, relative to the code folder
+    map<int, Evaluation> m_evaluations; // asynchronous evaluations by identifier, collected ones included
+    int m_nb_pending; // asynchronous evaluations submitted and not collected yet
+    deque<int> m_ready; // asynchronous evaluations whose runs are all finished, in order of completion
+    int m_racing; // racing test used to stop evaluating the positions that can't beat their threshold
+    double m_max_result; // best possible result of one run
+    double m_alpha; // risk of the racing t-test
+    int m_nb_simulations; // runs given to the pool since the beginning
+    int m_nb_cheap_simulations; // the ones on the cheap tier of the fidelity ladder
+    Surrogate* m_surrogate; // model of the evaluations already done, NULL when the positions aren't screened
+    double m_surrogate_kappa; // a position is clearly worse when its prediction plus kappa deviations is below the threshold
+    int m_surrogate_min; // evaluations needed before screening the positions
+    int m_nb_screened; // positions rejected by the surrogate since the beginning
+    vector<Job> m_batch; // buffers of evaluateBatch, kept from one batch to the next so that the jobs aren't allocated again
+    vector<int> m_batch_done;
+    vector<Job> m_round;
+    vector<int> m_round_positions;
+    bool m_ladder; // positions are screened on the cheap tier, only the best ones are run on the full tier
+    Scenario m_cheap_template; // template of the scenario with the length and physics iterations of the cheap tier
+    vector<int> m_cheap_seeds; // first seeds of m_seeds, run on the cheap tier
+    int m_ladder_length; // length of the cheap experiments in seconds, 0 : the length of the template
+    int m_ladder_iterations; // iterations of the physics engine per step on the cheap tier, 0 : the ones of the template
+    double m_ladder_promote; // fraction of the cheap evaluations promoted to the full tier
+    int m_ladder_window; // last cheap evaluations an evaluation is ranked against in the asynchronous mode
+    vector<double> m_cheap_results; // every cheap evaluation
+    vector<double> m_pairs_cheap; // evaluations of the positions run on both tiers, to measure how well the tiers agree
+    vector<double> m_pairs_full;
+    int m_nb_promoted; // positions run on the full tier with the ladder, the initial swarm included
+    int m_seed; // seed of the random streams of PSO
 
     Problem(int n, vector<double> * lower_bounds, vector<double> * upper_bounds);
     ~Problem();
@@ -26,6 +104,20 @@ public :
     double getLowerBound(int feature);
     double getUpperBound(int feature);
     bool evaluate(vector<double> * x, double * result); // Evaluates the given position according the objective function
+    bool evaluateBatch(vector<const double*> * xs, vector<double> * results, vector<double> * thresholds); // Evaluates several positions, all their runs in parallel (thresholds NULL : no racing)
+    bool simulate(vector<double> * x, int seed, double * result, int slot, int fidelity = FIDELITY_FULL); // Executes one argos run in the working directory of the slot
+    string experiment(); // Scenario, controller, objective and target objects, as sent to the workers and nodes
+
+    // Asynchronous mode : positions are submitted one by one and collected as soon as all their runs are done
+    bool submitEvaluation(int id, const double * x, double threshold);
+    bool waitEvaluation(int * id, double * result); // Blocks until one submitted evaluation is finished
+    int pendingEvaluations();
+
+    // Surrogate pre-screening : predicts whether the position can beat the threshold, without running argos
+    bool isClearlyWorse(const double * x, double threshold);
+
+    // Fidelity ladder : rank correlation between the cheap and the full evaluations of the positions run on both tiers
+    double ladderCorrelation();
     
     // Store results on files (the production version of the code only uses storeResult)
     bool storeResult(double result);
@@ -33,11 +125,47 @@ public :
     bool storeX(vector<double> * x); // Used for computing the ten pso solutions
 
     // Random generators
-    double getRandomX(int feature); // Computes a random position for the given feature
-    double getRandomV(int feature); // Computes a random velocity for the given feature
+    void set_seed(int seed);
+    // One counter-based stream per particle : the draws only depend on the seed, the stream and the counter,
+    // which is incremented by each draw, so the particles can draw from several threads
+    double getRandom01(int stream, uint64_t * counter); // Computes a random value in [0,1)
+    double getRandomX(int feature, int stream, uint64_t * counter); // Computes a random position for the given feature
+    double getRandomV(int feature, int stream, uint64_t * counter); // Computes a random velocity for the given feature
 
     // Setters
     void set_nb_robots(int nb_robots);
+    bool set_nb_seeds(int nbSeeds); // Before set_racing, set_ladder and set_nb_jobs
+    bool set_scenario(int scenario, string controller); // Loads the template of the scenario, after set_backend and before set_nb_jobs
+    bool set_objective(string objective, int targetObjects); // Before set_nb_jobs, the workers inherit it
+    bool set_nb_jobs(int nb_jobs); // Creates the working directories and the pool of threads
+    bool set_backend(int backend);
+    bool set_cache(string fileName, double tolerance);
+    bool set_racing(int racing, double maxResult, double alpha); // After set_scenario and set_objective, maxResult 0 : best result of the objective
+    bool set_surrogate(double kappa, int minSamples, int maxSamples);
+    bool set_ladder(double promote, int length, int iterations, int nbSeeds, int window); // After set_scenario and before set_nb_jobs
+    bool set_remote(int port, double timeout); // Opens the port the nodes connect to
+    void set_runs_directory(string directory);
+
+private:
+
+    bool checkPosition(const double * x);
+    bool evaluateTier(vector<const double*> * xs, vector<double> * results, vector<double> * thresholds, int fidelity);
+    bool promote(double cheap);
+    vector<int> & tierSeeds(int fidelity);
+    void prepareJobs(Evaluation * evaluation, int id, const double * x, int fidelity);
+    bool runJobs(vector<Job> * jobs);
+    bool canStillBeat(Job * runs, int nbDone, double threshold);
+    double studentQuantile(int degrees);
+    void advanceEvaluation(int id);
+    string scenarioName(int fidelity);
+    bool runShell(vector<double> * x, int seed, double * result, int slot, int fidelity);
+    bool runEngine(vector<double> * x, int seed, double * result, int slot);
+    bool runWorker(vector<double> * x, int seed, double * result, int slot);
+    bool runAnalytic(vector<double> * x, int seed, double * result, int fidelity);
+    bool runRemote(vector<double> * x, int seed, double * result);
+    string slotDirectory(int slot);
+    string scenarioFile(int slot, int seed, int fidelity);
+    bool prepareSlot(int slot);
 };
 
 #endif
\ No newline at end of file
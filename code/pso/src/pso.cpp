@@ -4,11 +4,24 @@
  ************************************/
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
 #include <string.h>
+#include <stdio.h>
 #include <chrono>
+#include <unistd.h>
 
 #include "problem.h"
-#include "particle.h"
+#include "swarm.h"
+#include "cache.h"
+#include "surrogate.h"
+#include "node.h"
+#include "errors.h"
+#ifdef COUNT_ALLOCATIONS
+#include "allocations.h"
+#endif
 
 using namespace std;
 
@@ -28,6 +41,34 @@ short topology;
 void (*setNeighborhood)();
 bool verbose;
 int nb_robots;
+int scenario; // arena of the experiments, their argos files are rendered from its template
+string controller; // pso (lua script) or native (the same controller compiled with the loop functions)
+string objective; // result of a run : objects at the end, area under the delivery curve or time to the target
+int target_objects;
+int nb_jobs; // number of argos runs executed at the same time
+int nb_move_threads; // threads moving the swarm, the trajectory doesn't depend on it
+bool async_mode; // particles move as soon as their own evaluation is done, instead of waiting for the whole swarm
+int backend; // how argos is executed (argos3 processes, simulator inside PSO or foraging workers)
+string cache_file; // file of the evaluation cache, empty when the cache isn't used
+double cache_tolerance;
+int racing; // racing test stopping the evaluation of the particles that can't beat their personal best
+double racing_alpha;
+double racing_max; // best possible result of one argos run, 0 : the one of the objective
+bool surrogate; // positions predicted to be clearly worse than the personal best are replaced by a new move
+double surrogate_kappa;
+int surrogate_min;
+int surrogate_samples;
+int surrogate_moves; // maximum number of moves replaced in a row for one particle
+bool ladder; // positions are screened by cheap simulations, only the most promising ones are run on the full scenario
+double ladder_promote; // fraction of the cheap evaluations promoted to the full scenario
+int ladder_length; // seconds of the cheap experiments
+int ladder_iterations; // physics iterations per step of the cheap experiments
+int ladder_seeds; // seeds of the cheap evaluations
+
+// Distributed runs
+int listen_port; // port the nodes connect to, with the remote backend
+double remote_timeout; // seconds a node can stay silent before its run is sent to another node, or without any node before a run fails, 0 for no limit
+string node_address; // <host>:<port> of the coordinator, this process is then a node and not an optimizer
 
 // Termination criteria
 int iterations = 0;
@@ -38,12 +79,27 @@ double time_limit_sec = 600*60;
 
 // PSO Seed
 int seed;
+int nb_seeds; // argos runs of an evaluation
+
+// Checkpoints
+string checkpoint_file; // empty when no checkpoint is written
+int checkpoint_every; // number of iterations between two checkpoints
+string resume_file; // checkpoint to continue from, empty for a new run
 
 // Swarm
-vector<Particle> swarm;
+Swarm swarm;
+vector<const double*> swarm_positions; // buffers of evaluateSwarm, sized once
+vector<double> swarm_thresholds;
+vector<double> swarm_evaluations;
 
 struct Solution global_best;
-Particle * best_particle(0);
+int best_particle = -1; // particle whose personal best is the global best
+vector<long> move_order; // rank of the last move of each particle, its evaluations are submitted in this order
+long nb_moves = 0;
+
+#ifdef COUNT_ALLOCATIONS
+long nb_iteration_allocations = 0; // allocations of the synchronous iterations, the first one excepted
+#endif
 
 // Time measurements
 typedef chrono::high_resolution_clock Time;
@@ -67,16 +123,16 @@ void createRingTopology(){
             b = 0;
         }
 
-		swarm[i].addNeighbour(&swarm[a]);
-		swarm[i].addNeighbour(&swarm[b]);
+		swarm.addNeighbour(i, a);
+		swarm.addNeighbour(i, b);
 	}
 }
 
 // Wheel Topology
 void createWheelTopology(){
 	for(int i = 1; i < nb_particles; i++){
-		swarm[i].addNeighbour(&swarm[0]);
-		swarm[0].addNeighbour(&swarm[i]);
+		swarm.addNeighbour(i, 0);
+		swarm.addNeighbour(0, i);
 	}
 }
 
@@ -85,7 +141,7 @@ void createGbestTopology(){
 	for (int i = 0; i < nb_particles; i++) {
 		for (int j=0;j<nb_particles;j++) {
 			if (i != j) {
-				swarm[i].addNeighbour(&swarm[j]);
+				swarm.addNeighbour(i, j);
 			}
 		}
 	}
@@ -97,7 +153,37 @@ void setDefaultParameters() {
     setNeighborhood = createRingTopology;
     verbose = true;
     nb_robots = 13;
+    scenario = 2;
+    controller = "pso";
+    objective = "objects";
+    target_objects = 0;
+    nb_jobs = 1;
+    nb_move_threads = 1;
+    async_mode = false;
+    backend = BACKEND_SHELL;
+    cache_file = "";
+    cache_tolerance = 0;
+    racing = RACING_NONE;
+    racing_alpha = 0.05;
+    racing_max = 0;
+    surrogate = false;
+    surrogate_kappa = 1;
+    surrogate_min = 20;
+    surrogate_samples = 300;
+    surrogate_moves = 10;
+    ladder = false;
+    ladder_promote = 0.25;
+    ladder_length = 100;
+    ladder_iterations = 10;
+    ladder_seeds = 1;
     seed = 1;
+    nb_seeds = 3;
+    checkpoint_file = "";
+    checkpoint_every = 1;
+    resume_file = "";
+    listen_port = 0;
+    remote_timeout = 1800;
+    node_address = "";
 }
 
 void printParameters() {
@@ -106,10 +192,25 @@ void printParameters() {
     cout << "   topology     = " << topology << endl;
     cout << "   verbose      = " << verbose << endl;
     cout << "   nb_robots    = " << nb_robots << endl;
+    cout << "   scenario     = " << scenario << endl;
+    cout << "   controller   = " << controller << endl;
+    cout << "   objective    = " << objective << " (target " << target_objects << " objects)" << endl;
+    cout << "   nb_jobs      = " << nb_jobs << endl;
+    cout << "   move_threads = " << nb_move_threads << endl;
+    cout << "   async        = " << async_mode << endl;
+    cout << "   backend      = " << backend << endl;
+    cout << "   cache        = " << cache_file << " (tolerance " << cache_tolerance << ")" << endl;
+    cout << "   racing       = " << racing << " (alpha " << racing_alpha << ", max " << racing_max << ")" << endl;
+    cout << "   surrogate    = " << surrogate << " (kappa " << surrogate_kappa << ", samples " << surrogate_min << " to " << surrogate_samples << ", moves " << surrogate_moves << ")" << endl;
+    cout << "   ladder       = " << ladder << " (promote " << ladder_promote << ", length " << ladder_length << ", iterations " << ladder_iterations << ", seeds " << ladder_seeds << ")" << endl;
+    cout << "   remote       = port " << listen_port << " (timeout " << remote_timeout << "), node of " << node_address << endl;
     cout << "   max_ite      = " << max_iterations << endl;
     cout << "   max_eval     = " << max_evaluations << endl;
     cout << "   time_limit(s)= " << time_limit_sec << endl;
-    cout << "   seed         = " << seed << endl << endl;
+    cout << "   seed         = " << seed << endl;
+    cout << "   nb_seeds     = " << nb_seeds << endl;
+    cout << "   checkpoint   = " << checkpoint_file << " (every " << checkpoint_every << " iterations)" << endl;
+    cout << "   resume       = " << resume_file << endl << endl;
 }
 
 bool readParameters(int argc, char *argv[] ){
@@ -124,12 +225,120 @@ bool readParameters(int argc, char *argv[] ){
         } else if(strcmp(argv[i], "--robots") == 0){
             nb_robots = atol(argv[i+1]);
             i+=2;
+        } else if(strcmp(argv[i], "--scenario") == 0){
+            scenario = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--controller") == 0){
+            controller = argv[i+1];
+            i+=2;
+        } else if(strcmp(argv[i], "--objective") == 0){
+            objective = argv[i+1];
+            i+=2;
+        } else if(strcmp(argv[i], "--target-objects") == 0){
+            target_objects = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--jobs") == 0){
+            nb_jobs = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--move-threads") == 0){
+            nb_move_threads = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--async") == 0){
+            async_mode = true;
+            i++;
+        } else if(strcmp(argv[i], "--backend") == 0){
+            if (strcmp(argv[i+1], "shell") == 0){
+                backend = BACKEND_SHELL;
+            } else if (strcmp(argv[i+1], "engine") == 0) {
+                backend = BACKEND_ENGINE;
+            } else if (strcmp(argv[i+1], "remote") == 0) {
+                backend = BACKEND_REMOTE;
+            } else if (strcmp(argv[i+1], "analytic") == 0) {
+                backend = BACKEND_ANALYTIC;
+            } else if (strcmp(argv[i+1], "workers") == 0) {
+                backend = BACKEND_WORKERS;
+            } else {
+                cout << "Parameter " << argv[i+1] << " no recognized.\n";
+                return false;
+            }
+            i+=2;
+        } else if(strcmp(argv[i], "--cache") == 0){
+            cache_file = argv[i+1];
+            i+=2;
+        } else if(strcmp(argv[i], "--cache-tolerance") == 0){
+            cache_tolerance = atof(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--racing") == 0){
+            if (strcmp(argv[i+1], "none") == 0){
+                racing = RACING_NONE;
+            } else if (strcmp(argv[i+1], "bound") == 0) {
+                racing = RACING_BOUND;
+            } else if (strcmp(argv[i+1], "ttest") == 0) {
+                racing = RACING_TTEST;
+            } else {
+                cout << "Parameter " << argv[i+1] << " no recognized.\n";
+                return false;
+            }
+            i+=2;
+        } else if(strcmp(argv[i], "--racing-alpha") == 0){
+            racing_alpha = atof(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--racing-max") == 0){
+            racing_max = atof(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--surrogate") == 0){
+            surrogate = true;
+            surrogate_kappa = atof(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--surrogate-min") == 0){
+            surrogate_min = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--surrogate-samples") == 0){
+            surrogate_samples = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--surrogate-moves") == 0){
+            surrogate_moves = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--ladder") == 0){
+            ladder = true;
+            ladder_promote = atof(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--ladder-length") == 0){
+            ladder_length = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--ladder-iterations") == 0){
+            ladder_iterations = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--ladder-seeds") == 0){
+            ladder_seeds = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--listen") == 0){
+            listen_port = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--remote-timeout") == 0){
+            remote_timeout = atof(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--node") == 0){
+            node_address = argv[i+1];
+            i+=2;
+        } else if(strcmp(argv[i], "--checkpoint") == 0){
+            checkpoint_file = argv[i+1];
+            i+=2;
+        } else if(strcmp(argv[i], "--checkpoint-every") == 0){
+            checkpoint_every = atol(argv[i+1]);
+            i+=2;
+        } else if(strcmp(argv[i], "--resume") == 0){
+            resume_file = argv[i+1];
+            i+=2;
         } else if(strcmp(argv[i], "--evaluations") == 0){
             max_evaluations = atol(argv[i+1]);
             i+=2;
         } else if(strcmp(argv[i], "--seed") == 0){
             seed = atol(argv[i+1]);
             i+=2;
+        } else if(strcmp(argv[i], "--seeds") == 0){
+            nb_seeds = atol(argv[i+1]);
+            i+=2;
         } else if(strcmp(argv[i], "--verbose") == 0){
             if (strcmp(argv[i+1], "true") == 0){
 			    verbose = true;
@@ -158,107 +367,475 @@ bool readParameters(int argc, char *argv[] ){
 		}
 	}
 
+    // A resumed run keeps writing its checkpoints in the same file by default
+    if (resume_file != "" && checkpoint_file == "") {
+        checkpoint_file = resume_file;
+    }
+
 	if (verbose) { printParameters(); }
 
 	return true;
 }
 
-void initialize() {
+bool initialize() {
     global_best.x.resize(problem.getSize(),0);
+    move_order.assign(nb_particles, 0);
     global_best.eval = 0;
+    problem.set_seed(seed);
+    swarm.set_nb_threads(nb_move_threads);
     problem.set_nb_robots(nb_robots);
+    if (!problem.set_nb_seeds(nb_seeds)) { return false; }
+    if (!problem.set_backend(backend)) { return false; }
+    if (!problem.set_scenario(scenario, controller)) { return false; }
+    if (!problem.set_objective(objective, target_objects)) { return false; }
+    if (cache_file != "" && !problem.set_cache(cache_file, cache_tolerance)) { return false; }
+    if (!problem.set_racing(racing, racing_max, racing_alpha)) { return false; }
+    if (surrogate && !problem.set_surrogate(surrogate_kappa, surrogate_min, surrogate_samples)) { return false; }
+    if (ladder && !problem.set_ladder(ladder_promote, ladder_length, ladder_iterations, ladder_seeds, nb_particles)) { return false; }
+    if (backend == BACKEND_REMOTE) {
+        if (listen_port <= 0) {
+            generateError("pso.cpp","initialize","the remote backend needs --listen <port>");
+            return false;
+        }
+        if (!problem.set_remote(listen_port, remote_timeout)) { return false; }
+    }
+    if (node_address != "") {
+        char hostname[256];
+        gethostname(hostname, sizeof(hostname));
+        problem.set_runs_directory("runs/node_" + string(hostname) + "_" + to_string(getpid()));
+    }
+    return problem.set_nb_jobs(nb_jobs);
 }
 
-// Update global best solution found
-void updateGlobalBest(vector<double> x, double eval){
-	global_best.x = x;
-	global_best.eval = eval;
+// Update global best with the personal best of the particle, copied in place
+void updateGlobalBest(int particle){
+    const double * x = swarm.getPBestPosition(particle);
+	global_best.x.assign(x, x + problem.getSize());
+	global_best.eval = swarm.m_pBest_eval[particle];
+    best_particle = particle;
+}
+
+// Evaluate the current position of every particle, all the argos runs of the swarm are done in parallel.
+// With racing, the evaluation of a particle stops when it can't beat its personal best anymore.
+bool evaluateSwarm(bool race) {
+    vector<const double*> & positions = swarm_positions;
+    vector<double> & thresholds = swarm_thresholds;
+    vector<double> & evaluations = swarm_evaluations;
+    positions.resize(nb_particles);
+    thresholds.resize(nb_particles);
+
+    for (int i = 0; i < nb_particles; i++) {
+        positions[i] = swarm.getCurrentPosition(i);
+        thresholds[i] = swarm.m_pBest_eval[i];
+    }
+    if (!problem.evaluateBatch(&positions, &evaluations, race ? &thresholds : NULL)) { return false; }
+    for (int i = 0; i < nb_particles; i++) {
+        swarm.m_eval[i] = evaluations[i];
+    }
+    return true;
+}
+
+// Update global best with the personal bests, in the order of the particles
+void updateSwarmBest() {
+    for (int i = 0; i < nb_particles; i++) {
+        if (global_best.eval < swarm.m_pBest_eval[i]) {
+            updateGlobalBest(i);
+        }
+    }
 }
 
 // Create swarm structure
-void createSwarm (){
+bool createSwarm (){
     if (verbose) { cout << "Creating swarm..." << endl; }
-	Particle p = Particle();
-	for (int i = 0; i < nb_particles; i++) {
-		p = Particle(&problem);
-		swarm.push_back(p);
-		if (global_best.eval < p.getPBestEvaluation()){
-			updateGlobalBest(p.getPBestPosition(), p.getPBestEvaluation());
-			best_particle = &p;
-		}
-	}
+    if (!swarm.create(&problem, nb_particles)) { return false; }
+    if (!evaluateSwarm(false)) { return false; }
+    for (int i = 0; i < nb_particles; i++) {
+        swarm.m_pBest_eval[i] = swarm.m_eval[i];
+    }
+    updateSwarmBest();
     setNeighborhood();
 	if (verbose) { cout << "\n\tBest initial solution quality: " << global_best.eval << "\n"<< endl; }
+    return true;
+}
+
+// With the surrogate, a position predicted to be clearly worse than the personal best isn't simulated :
+// the particle keeps moving along its trajectory, up to surrogate_moves times.
+void screenParticle(int i) {
+    for (int k = 0; k < surrogate_moves && problem.isClearlyWorse(swarm.getCurrentPosition(i), swarm.m_pBest_eval[i]); k++) {
+        swarm.move(i);
+    }
+}
+
+void moveParticle(int i) {
+    swarm.move(i);
+    screenParticle(i);
+    move_order[i] = nb_moves++;
 }
 
+// Every particle moves according to the personal bests of the previous iteration, then the whole swarm is evaluated.
+// With the surrogate, each particle is moved then screened before the next one, the order of the draws of the
+// original loop ; the streams of the particles being independent, moveAll would give the same trajectories.
 bool moveSwarm() {
     if (verbose) { cout << "Move swarm..." << endl; }
+    if (surrogate) {
+        for (int i = 0; i < nb_particles; i++) {
+            moveParticle(i);
+        }
+    }
+    else {
+        swarm.moveAll();
+    }
+    if (!evaluateSwarm(true)) { return false; }
     for (int i = 0; i < nb_particles; i++) {
-        // Move the particule
-        if (!swarm[i].move()) { return false; }
+        swarm.updatePBest(i);
         if (verbose) {
-            swarm[i].printPosition();
+            swarm.printPosition(i);
+        }
+    }
+    updateSwarmBest();
+    return true;
+}
+
+void writeSolution(ostream & stream, double eval, const double * x) {
+    stream << eval;
+    for (int i = 0; i < problem.getSize(); i++) {
+        stream << " " << x[i];
+    }
+    stream << endl;
+}
+
+void readSolution(istream & stream, double * eval, double * x) {
+    stream >> *eval;
+    for (int i = 0; i < problem.getSize(); i++) {
+        stream >> x[i];
+    }
+}
+
+// Writes the whole state of the optimizer. The file is written next to the checkpoint and then renamed,
+// so a crash while writing never leaves a broken checkpoint. Doubles are written with 17 digits, enough
+// to read back exactly the same values.
+bool saveCheckpoint() {
+    string temporaryFile = checkpoint_file + ".tmp";
+    ofstream stream(temporaryFile.c_str());
+    if (!stream) {
+        generateError("pso.cpp","saveCheckpoint","impossible to open a file","file_name",temporaryFile);
+        return false;
+    }
+
+    nbSec = Time::now() - start;
+    stream << setprecision(17);
+    stream << "nb_particles " << nb_particles << endl;
+    stream << "topology " << topology << endl;
+    stream << "async " << async_mode << endl;
+    stream << "nb_robots " << nb_robots << endl;
+    stream << "iterations " << iterations << endl;
+    stream << "evaluations " << evaluations << endl;
+    stream << "elapsed " << nbSec.count() << endl;
+    stream << "best_particle " << best_particle << endl;
+    stream << "counters";
+    for (int i = 0; i < nb_particles; i++) {
+        stream << " " << swarm.m_counters[i];
+    }
+    stream << endl;
+    stream << "global_best ";
+    writeSolution(stream, global_best.eval, &global_best.x[0]);
+    for (int i = 0; i < nb_particles; i++) {
+        stream << "current ";
+        writeSolution(stream, swarm.m_eval[i], swarm.getCurrentPosition(i));
+        stream << "pbest ";
+        writeSolution(stream, swarm.m_pBest_eval[i], swarm.getPBestPosition(i));
+        stream << "velocity";
+        for (int j = 0; j < problem.getSize(); j++) {
+            stream << " " << swarm.getVelocity(i)[j];
+        }
+        stream << endl;
+    }
+    int nb_samples = (problem.m_surrogate == NULL ? 0 : problem.m_surrogate->size());
+    stream << "surrogate " << nb_samples << endl;
+    for (int k = 0; k < nb_samples; k++) {
+        for (int j = 0; j < problem.getSize(); j++) {
+            stream << problem.m_surrogate->m_xs[k][j] << " ";
+        }
+        stream << problem.m_surrogate->m_ys[k] << endl;
+    }
+    stream << "ladder " << problem.m_nb_promoted << " " << problem.m_cheap_results.size() << " " << problem.m_pairs_full.size() << endl;
+    for (int k = 0; k < problem.m_cheap_results.size(); k++) {
+        stream << problem.m_cheap_results[k] << " ";
+    }
+    stream << endl;
+    for (int k = 0; k < problem.m_pairs_full.size(); k++) {
+        stream << problem.m_pairs_cheap[k] << " " << problem.m_pairs_full[k] << endl;
+    }
+    stream << "order";
+    for (int i = 0; i < nb_particles; i++) {
+        stream << " " << move_order[i];
+    }
+    stream << endl;
+    stream.close();
+
+    if (!stream || rename(temporaryFile.c_str(), checkpoint_file.c_str()) != 0) {
+        generateError("pso.cpp","saveCheckpoint","impossible to write the checkpoint","file_name",checkpoint_file);
+        return false;
+    }
+    return true;
+}
+
+// Rebuilds the swarm from a checkpoint instead of creating it. The swarm options must be the same as the
+// ones of the interrupted run, the evaluation cache is already on disk.
+bool loadCheckpoint() {
+    ifstream stream(resume_file.c_str());
+    if (!stream) {
+        generateError("pso.cpp","loadCheckpoint","impossible to open a file","file_name",resume_file);
+        return false;
+    }
+
+    string label;
+    int saved_particles, saved_robots, best_index;
+    short saved_topology;
+    bool saved_async;
+    float elapsed;
+
+    stream >> label >> saved_particles >> label >> saved_topology >> label >> saved_async >> label >> saved_robots;
+    if (saved_particles != nb_particles || saved_topology != topology || saved_async != async_mode || saved_robots != nb_robots) {
+        generateError("pso.cpp","loadCheckpoint","the checkpoint was written with other particles, topology, async or robots options","file_name",resume_file);
+        return false;
+    }
+
+    // Creating the particles draws random positions, the counters of the streams are restored afterwards
+    if (!swarm.create(&problem, nb_particles)) { return false; }
+
+    stream >> label >> iterations >> label >> evaluations >> label >> elapsed >> label >> best_index;
+    stream >> label;
+    for (int i = 0; i < nb_particles; i++) {
+        stream >> swarm.m_counters[i];
+    }
+    stream >> label;
+    readSolution(stream, &global_best.eval, &global_best.x[0]);
+    for (int i = 0; i < nb_particles; i++) {
+        stream >> label;
+        readSolution(stream, &swarm.m_eval[i], swarm.getCurrentPosition(i));
+        stream >> label;
+        readSolution(stream, &swarm.m_pBest_eval[i], swarm.getPBestPosition(i));
+        stream >> label;
+        for (int j = 0; j < problem.getSize(); j++) {
+            stream >> swarm.getVelocity(i)[j];
         }
-        // Update global best particle
-        if (global_best.eval < swarm[i].getPBestEvaluation()) {
-            updateGlobalBest(swarm[i].getPBestPosition(), swarm[i].getPBestEvaluation());
-            best_particle = &swarm[i];
+    }
+    int nb_samples;
+    stream >> label >> nb_samples;
+    for (int k = 0; k < nb_samples && stream; k++) {
+        vector<double> x(problem.getSize());
+        double y;
+        for (int j = 0; j < problem.getSize(); j++) {
+            stream >> x[j];
         }
+        stream >> y;
+        if (problem.m_surrogate != NULL) { problem.m_surrogate->add(&x, y); }
     }
+    // Checkpoints written before the fidelity ladder end with the surrogate
+    int nb_cheap = 0, nb_pairs = 0;
+    bool truncated = !stream;
+    if (!truncated && stream >> label && label == "ladder") {
+        stream >> problem.m_nb_promoted >> nb_cheap >> nb_pairs;
+        problem.m_cheap_results.resize(nb_cheap);
+        for (int k = 0; k < nb_cheap; k++) {
+            stream >> problem.m_cheap_results[k];
+        }
+        problem.m_pairs_cheap.resize(nb_pairs);
+        problem.m_pairs_full.resize(nb_pairs);
+        for (int k = 0; k < nb_pairs; k++) {
+            stream >> problem.m_pairs_cheap[k] >> problem.m_pairs_full[k];
+        }
+    } else if (!truncated) {
+        stream.clear();
+    }
+    // Checkpoints written before the order of the moves keep the order of the particles
+    truncated = !stream;
+    if (!truncated && stream >> label && label == "order") {
+        for (int i = 0; i < nb_particles; i++) {
+            stream >> move_order[i];
+            nb_moves = max(nb_moves, move_order[i] + 1);
+        }
+    } else if (!truncated) {
+        stream.clear();
+    }
+    if (!stream) {
+        generateError("pso.cpp","loadCheckpoint","truncated checkpoint","file_name",resume_file);
+        return false;
+    }
+
+    best_particle = best_index;
+    setNeighborhood();
+    start = Time::now() - chrono::duration_cast<Time::duration>(fsec(elapsed));
+
+    if (verbose) { cout << "Resumed after " << iterations << " iterations, global best = " << global_best.eval << endl; }
     return true;
 }
 
-bool terminationCondition() {
+// Evaluations still running count as done, so that the asynchronous mode never submits more than the budget
+bool terminationCondition(int pending = 0) {
     end_time = Time::now();
     nbSec = end_time - start;
-    return (nbSec.count() > time_limit_sec or evaluations >= max_evaluations or iterations >= max_iterations);
+    return (nbSec.count() > time_limit_sec or evaluations + pending >= max_evaluations or iterations >= max_iterations);
 }
 
-int main(int argc, char* argv[]) {
-    // Set seed
-    srand(seed);
+// Print current global best, computation time and evaluations done
+void printProgress() {
+    nbSec = Time::now() - start;
+    cout << "\nglobal best = " << global_best.eval << endl << endl;
+    cout << "\ntime = " << nbSec.count()/(double)60 << endl;
+    cout << "evals  = " << evaluations << endl << endl;
+    if (problem.m_cache != NULL) {
+        cout << "cache  = " << problem.m_cache->m_hits << " hits, " << problem.m_cache->m_misses << " runs" << endl << endl;
+    }
+    cout << "sims   = " << problem.m_nb_simulations << endl << endl;
+    if (problem.m_surrogate != NULL) {
+        cout << "screen = " << problem.m_nb_screened << " positions rejected" << endl << endl;
+    }
+    if (problem.m_ladder) {
+        int nb_full = problem.m_nb_simulations - problem.m_nb_cheap_simulations;
+        cout << "ladder = " << problem.m_cheap_results.size() << " cheap, " << problem.m_nb_promoted << " promoted, spearman "
+             << problem.ladderCorrelation() << " (" << problem.m_pairs_full.size() << " pairs)" << endl;
+        cout << "         simulations " << problem.m_nb_cheap_simulations << " cheap, " << nb_full << " full ("
+             << 100.*nb_full/max(1, problem.m_nb_simulations) << "% full)" << endl << endl;
+    }
+}
+
+// Synchronous PSO : the whole swarm moves, then waits for the evaluation of all the particles
+bool runSynchronous() {
+	while(!terminationCondition()){
+#ifdef COUNT_ALLOCATIONS
+        // The first iteration sizes the buffers kept by the next ones
+        long allocations = countedAllocations();
+#endif
+        // Move swarm
+		if (!moveSwarm()) { return false; }
+#ifdef COUNT_ALLOCATIONS
+        if (iterations > 0) { nb_iteration_allocations += countedAllocations() - allocations; }
+#endif
 
+        // Increment counters
+		evaluations = evaluations + nb_particles;
+		iterations++;
+
+        if (checkpoint_file != "" && iterations % checkpoint_every == 0) {
+            if (!saveCheckpoint()) { return false; }
+        }
+
+        if (verbose) { printProgress(); }
+	}
+    return true;
+}
+
+// Asynchronous PSO : as soon as the evaluation of a particle is finished, its personal best and the global best
+// are updated, and it moves again with the personal bests its neighbours have at this moment. The pool always
+// has work as long as the budget allows it, no particle waits for the slowest run of an iteration.
+// An iteration is counted every nb_particles evaluations.
+bool runAsynchronous() {
+    int id;
+    double eval;
+
+    // The particles of a checkpoint were all moved and waiting for the evaluation of their current position, which
+    // are submitted in the order of their moves : with one job the runs are done in the same order as without the
+    // interruption
+    vector<int> particles(nb_particles);
+    for (int i = 0; i < nb_particles; i++) {
+        particles[i] = i;
+    }
+    if (resume_file != "") {
+        stable_sort(particles.begin(), particles.end(), [](int a, int b) { return move_order[a] < move_order[b]; });
+    }
+    for (int k = 0; k < nb_particles && !terminationCondition(problem.pendingEvaluations()); k++) {
+        int i = particles[k];
+        if (resume_file == "") { moveParticle(i); }
+        if (!problem.submitEvaluation(i, swarm.getCurrentPosition(i), swarm.m_pBest_eval[i])) { return false; }
+    }
+
+    while (problem.pendingEvaluations() > 0) {
+        if (!problem.waitEvaluation(&id, &eval)) { return false; }
+        swarm.m_eval[id] = eval;
+        swarm.updatePBest(id);
+        if (global_best.eval < swarm.m_pBest_eval[id]) {
+            updateGlobalBest(id);
+        }
+        if (verbose) {
+            swarm.printPosition(id);
+        }
+
+        // The particle moves even when the budget is spent, as it would with a larger one, so that a checkpoint
+        // of the end of the run is continued by --resume with the same moves
+        evaluations++;
+        moveParticle(id);
+        if (!terminationCondition(problem.pendingEvaluations())) {
+            if (!problem.submitEvaluation(id, swarm.getCurrentPosition(id), swarm.m_pBest_eval[id])) { return false; }
+        }
+
+        if (evaluations % nb_particles == 0) {
+            iterations++;
+            if (checkpoint_file != "" && iterations % checkpoint_every == 0) {
+                if (!saveCheckpoint()) { return false; }
+            }
+            if (verbose) { printProgress(); }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
     // Measure start time
     start = Time::now();
 
     // Parse parameters
     if (!readParameters(argc,argv)) { return false; }
 
-    // Initialize global best and number of robots (always 13 in the lastest version)
-    initialize();
+    // Initialize seed, global best, number of robots (always 13 in the lastest version) and parallel jobs
+    if (!initialize()) { return false; }
 
-    // Create the population of particles
-    createSwarm();
+    // A node only runs the simulations of a coordinator, until the coordinator stops
+    if (node_address != "") {
+        size_t colon = node_address.rfind(':');
+        if (colon == string::npos) {
+            generateError("pso.cpp","main","--node expects <host>:<port>","node",node_address);
+            return false;
+        }
+        Node node(&problem);
+        if (!node.serve(node_address.substr(0, colon), atol(node_address.substr(colon + 1).c_str()))) { return false; }
+        return 0;
+    }
+
+    // Create the population of particles, or take it back from the checkpoint
+    if (resume_file != "") {
+        if (!loadCheckpoint()) { return false; }
+    }
+    else if (!createSwarm()) { return false; }
 
     // Print informations on the initial population and global best evaluation 
     if (verbose) { 
         cout << "Initial Swarm :" << endl;
 
         for (int i = 0; i < nb_particles; i++) {
-            swarm[i].printPosition();
+            swarm.printPosition(i);
         }
     }
 
     if (verbose) { cout << "\nglobal best = " << global_best.eval << endl << endl; }
 
     // Iterations loop
-	while(!terminationCondition()){
-        // Move swarm
-		if (!moveSwarm()) { return false; }
-
-        // Increment counters
-		evaluations = evaluations + nb_particles;
-		iterations++;
-        nbSec = Time::now() - start;
+    if (async_mode) {
+        if (!runAsynchronous()) { return false; }
+    }
+    else if (!runSynchronous()) { return false; }
 
-        // Print current global best, computation time and evaluations done
-        if (verbose) {
-            cout << "\nglobal best = " << global_best.eval << endl << endl;
-            cout << "\ntime = " << nbSec.count()/(double)60 << endl;
-            cout << "evals  = " << evaluations << endl << endl;
-        }
-	}
+    // Write result on file, the analytic backend is a benchmarking stub and its result isn't one of the foraging task
+    if (backend != BACKEND_ANALYTIC) { problem.storeResult(global_best.eval); }
 
-    // Write result on file
-    problem.storeResult(global_best.eval);
+#ifdef COUNT_ALLOCATIONS
+    // A budget of one iteration measures nothing, it doesn't pass the check
+    if (async_mode || iterations < 2) {
+        generateError("pso.cpp","main","the allocations are measured on at least 2 synchronous iterations","iterations",iterations);
+        return 1;
+    }
+    cout << "allocations = " << nb_iteration_allocations << " in " << iterations - 1 << " iterations after the first" << endl;
+    return (nb_iteration_allocations == 0 ? 0 : 1);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*****************************************************************
+ * Counter-based random numbers (Philox4x32-10, Salmon et al.)  *
+ *****************************************************************/
+
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * Philox4x32 with 10 rounds : a bijection of the 128 bits counter, parametrized by the 64 bits key.
+ * The output only depends on the key and on the counter, so any number of independent streams can be
+ * drawn from any number of threads, in any order, and a stream is saved by saving its counter.
+ *
+ * @param[in] key Two 32 bits words, the seed of the stream
+ * @param[in,out] counter Four 32 bits words, replaced by the random output
+ */
+inline void philox4x32(const uint32_t key[2], uint32_t counter[4])
+{
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+
+    for (int round = 0; round < 10; round++) {
+        uint64_t product0 = (uint64_t) 0xD2511F53 * counter[0];
+        uint64_t product1 = (uint64_t) 0xCD9E8D57 * counter[2];
+        uint32_t c1 = counter[1];
+        uint32_t c3 = counter[3];
+
+        counter[0] = (uint32_t) (product1 >> 32) ^ c1 ^ k0;
+        counter[1] = (uint32_t) product1;
+        counter[2] = (uint32_t) (product0 >> 32) ^ c3 ^ k1;
+        counter[3] = (uint32_t) product0;
+
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+}
+
+/**
+ * Uniform value in [0,1) : the index-th draw of the stream identified by (seed, stream)
+ *
+ * @param[in] seed Seed of the whole run
+ * @param[in] stream Identifier of the stream, for instance a particle
+ * @param[in] index Position of the draw in the stream
+ * @return a double with 53 random bits
+ */
+inline double philoxUniform(uint32_t seed, uint32_t stream, uint64_t index)
+{
+    uint32_t key[2] = {seed, stream};
+    uint32_t counter[4] = {(uint32_t) index, (uint32_t) (index >> 32), 0, 0};
+    philox4x32(key, counter);
+
+    uint64_t bits = ((uint64_t) counter[0] << 32 | counter[1]) >> 11;
+    return bits*(1.0/9007199254740992.0); // 2^-53
+}
+
+#endif
@@ -0,0 +1,101 @@
+/****************************************
+ * Implementation of the class Scenario *
+ ****************************************/
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+#include "scenario.h"
+#include "errors.h"
+
+using namespace std;
+
+Scenario::Scenario() {}
+
+Scenario::~Scenario() {}
+
+// The seed is the random_seed attribute of the experiment tag, the robots are the quantity of the entity
+// distributing the foot-bots (the objects are distributed by another entity)
+bool Scenario::load(string fileName) {
+    ifstream stream(fileName.c_str());
+    if (!stream) {
+        generateError("scenario.cpp","load","impossible to open a file","file_name",fileName);
+        return false;
+    }
+    stringstream content;
+    content << stream.rdbuf();
+    string text = content.str();
+
+    size_t experiment = text.find("<experiment ");
+    size_t seedBegin = text.find("random_seed=\"", experiment);
+    size_t footBot = text.find("<foot-bot ");
+    size_t entity = (footBot == string::npos ? string::npos : text.rfind("<entity ", footBot));
+    size_t quantityBegin = text.find("quantity=\"", entity);
+    if (experiment == string::npos || seedBegin == string::npos || entity == string::npos || quantityBegin == string::npos
+        || quantityBegin > footBot) {
+        generateError("scenario.cpp","load","no random_seed or foot-bot quantity in the template","file_name",fileName);
+        return false;
+    }
+    seedBegin += string("random_seed=\"").size();
+    quantityBegin += string("quantity=\"").size();
+    size_t seedEnd = text.find('"', seedBegin);
+    size_t quantityEnd = text.find('"', quantityBegin);
+
+    m_template_file = fileName;
+    m_head = text.substr(0, seedBegin);
+    m_middle = text.substr(seedEnd, quantityBegin - seedEnd);
+    m_tail = text.substr(quantityEnd);
+    return true;
+}
+
+// The experiment tag is before the seed, in the head, and the physics engine after the foot-bots, in the tail.
+// Used by the cheap tier of the fidelity ladder : shorter experiments, coarser physics.
+bool Scenario::setFidelity(int length, int iterations) {
+    if (length > 0 && !setAttribute(&m_head, "<experiment ", "length", to_string(length))) { return false; }
+    if (iterations > 0 && !setAttribute(&m_tail, "<dynamics2d ", "iterations", to_string(iterations))) { return false; }
+    return true;
+}
+
+bool Scenario::length(double * seconds) {
+    size_t valueBegin, valueEnd;
+    if (!findAttribute(&m_head, "<experiment ", "length", &valueBegin, &valueEnd)) { return false; }
+    *seconds = atof(m_head.substr(valueBegin, valueEnd - valueBegin).c_str());
+    return true;
+}
+
+// Position of the value of an attribute of the first tag of the text
+bool Scenario::findAttribute(string * text, string tag, string attribute, size_t * valueBegin, size_t * valueEnd) {
+    size_t tagBegin = text->find(tag);
+    size_t tagEnd = (tagBegin == string::npos ? string::npos : text->find('>', tagBegin));
+    *valueBegin = (tagBegin == string::npos ? string::npos : text->find(" " + attribute + "=\"", tagBegin));
+    if (tagBegin == string::npos || *valueBegin == string::npos || *valueBegin > tagEnd) {
+        generateError("scenario.cpp","findAttribute","attribute not found in the template","attribute",attribute);
+        return false;
+    }
+    *valueBegin += attribute.size() + 3;
+    *valueEnd = text->find('"', *valueBegin);
+    return true;
+}
+
+// Replaces the value of an attribute of the first tag of the text
+bool Scenario::setAttribute(string * text, string tag, string attribute, string value) {
+    size_t valueBegin, valueEnd;
+    if (!findAttribute(text, tag, attribute, &valueBegin, &valueEnd)) { return false; }
+    text->replace(valueBegin, valueEnd - valueBegin, value);
+    return true;
+}
+
+string Scenario::render(int seed, int nbRobots) {
+    return m_head + to_string(seed) + m_middle + to_string(nbRobots) + m_tail;
+}
+
+bool Scenario::write(string fileName, int seed, int nbRobots) {
+    ofstream stream(fileName.c_str());
+    if (!stream) {
+        generateError("scenario.cpp","write","impossible to open a file","file_name",fileName);
+        return false;
+    }
+    stream << render(seed, nbRobots);
+    return !stream.fail();
+}
@@ -0,0 +1,42 @@
+/*************************************
+ * Declaration of the class Scenario *
+ *************************************/
+
+#ifndef SCENARIO_H_
+#define SCENARIO_H_
+
+#include <string>
+
+using namespace std;
+
+/**
+ * Argos file of an experiment, built in memory from a template of "/code/argos_files/templates".
+ * The files of a scenario only differ by the random_seed of the experiment and the quantity of foot-bots, so
+ * the template is split once around these two values and a file for any (seed, robots) pair is a concatenation.
+ * The rendered files are byte for byte the ones of "/code/argos_files/configured_scenarios".
+ */
+class Scenario {
+
+public:
+
+    string m_template_file;
+    string m_head; // text before the value of random_seed
+    string m_middle; // text between the seed and the quantity of foot-bots
+    string m_tail; // text after the quantity of foot-bots
+
+    Scenario();
+    ~Scenario();
+
+    bool load(string fileName); // Reads and splits the template
+    bool setFidelity(int length, int iterations); // Changes the length of the experiment and the iterations of the physics engine (0 : unchanged)
+    bool length(double * seconds); // Length of the experiment, the best result of the time objective
+    string render(int seed, int nbRobots);
+    bool write(string fileName, int seed, int nbRobots); // Writes the rendered argos file, argos3 only reads files
+
+private:
+
+    bool findAttribute(string * text, string tag, string attribute, size_t * valueBegin, size_t * valueEnd);
+    bool setAttribute(string * text, string tag, string attribute, string value);
+};
+
+#endif
@@ -0,0 +1,155 @@
+/*****************************************
+ * Implementation of the class Surrogate *
+ *****************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "surrogate.h"
+
+using namespace std;
+
+#define NOISE_RATIO 0.1 // part of the variance of the evaluations due to the seeds of argos
+
+Surrogate::Surrogate(vector<double> * lower_bounds, vector<double> * upper_bounds, int max_samples) {
+    m_lower_bounds = *lower_bounds;
+    m_upper_bounds = *upper_bounds;
+    m_max_samples = max_samples;
+    m_fitted = false;
+}
+
+Surrogate::~Surrogate(){};
+
+void Surrogate::add(vector<double> * x, double y) {
+    m_xs.push_back(*x);
+    m_ys.push_back(y);
+
+    if (m_xs.size() > m_max_samples) {
+        m_xs.erase(m_xs.begin());
+        m_ys.erase(m_ys.begin());
+    }
+    m_fitted = false;
+}
+
+int Surrogate::size() {
+    return m_xs.size();
+}
+
+bool Surrogate::predict(const double * x, double * mean, double * deviation) {
+    if (!m_fitted && !fit()) { return false; }
+
+    int n = m_xs.size();
+    vector<double> normalized;
+    normalize(x, &normalized);
+
+    // mean = m + k.w, variance = s2 - |v|^2 with L v = k
+    vector<double> v(n);
+    double sum = 0.;
+    for (int i = 0; i < n; i++) {
+        v[i] = kernel(&normalized, &m_normalized[i]);
+        sum += v[i]*m_weights[i];
+    }
+    *mean = m_mean + sum;
+
+    double explained = 0.;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < i; j++) {
+            v[i] -= m_cholesky[i*n + j]*v[j];
+        }
+        v[i] /= m_cholesky[i*n + i];
+        explained += v[i]*v[i];
+    }
+    *deviation = sqrt(max(0., m_variance - explained));
+
+    return true;
+}
+
+void Surrogate::normalize(const double * x, vector<double> * normalized) {
+    normalized->resize(m_lower_bounds.size());
+    for (int i = 0; i < normalized->size(); i++) {
+        normalized->at(i) = (x[i] - m_lower_bounds[i])/(m_upper_bounds[i] - m_lower_bounds[i]);
+    }
+}
+
+double Surrogate::kernel(vector<double> * a, vector<double> * b) {
+    double distance2 = 0.;
+    for (int i = 0; i < a->size(); i++) {
+        distance2 += (a->at(i) - b->at(i))*(a->at(i) - b->at(i));
+    }
+    return (1. - NOISE_RATIO)*m_variance*exp(-distance2/(2.*m_length*m_length));
+}
+
+// Cholesky decomposition of the covariance matrix, then resolution of the two triangular systems giving the weights
+bool Surrogate::fit() {
+    int n = m_xs.size();
+    if (n < 2) { return false; }
+
+    m_mean = 0.;
+    for (int i = 0; i < n; i++) {
+        m_mean += m_ys[i];
+    }
+    m_mean /= (double)n;
+
+    m_variance = 0.;
+    for (int i = 0; i < n; i++) {
+        m_variance += (m_ys[i] - m_mean)*(m_ys[i] - m_mean);
+    }
+    m_variance /= (double)(n - 1);
+    if (m_variance <= 0.) { return false; } // every evaluation is the same, nothing to learn
+
+    m_normalized.resize(n);
+    for (int i = 0; i < n; i++) {
+        normalize(&m_xs[i][0], &m_normalized[i]);
+    }
+
+    vector<double> distances;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < i; j++) {
+            double distance2 = 0.;
+            for (int k = 0; k < m_normalized[i].size(); k++) {
+                distance2 += (m_normalized[i][k] - m_normalized[j][k])*(m_normalized[i][k] - m_normalized[j][k]);
+            }
+            distances.push_back(sqrt(distance2));
+        }
+    }
+    nth_element(distances.begin(), distances.begin() + distances.size()/2, distances.end());
+    m_length = max(1e-3, distances[distances.size()/2]);
+
+    m_cholesky.assign(n*n, 0.);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double value = kernel(&m_normalized[i], &m_normalized[j]);
+            if (i == j) { value += NOISE_RATIO*m_variance; }
+            for (int k = 0; k < j; k++) {
+                value -= m_cholesky[i*n + k]*m_cholesky[j*n + k];
+            }
+            if (i == j) {
+                if (value <= 0.) { return false; }
+                m_cholesky[i*n + i] = sqrt(value);
+            }
+            else {
+                m_cholesky[i*n + j] = value/m_cholesky[j*n + j];
+            }
+        }
+    }
+
+    // L z = y - m, then L^T w = z
+    m_weights.resize(n);
+    for (int i = 0; i < n; i++) {
+        double value = m_ys[i] - m_mean;
+        for (int k = 0; k < i; k++) {
+            value -= m_cholesky[i*n + k]*m_weights[k];
+        }
+        m_weights[i] = value/m_cholesky[i*n + i];
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double value = m_weights[i];
+        for (int k = i + 1; k < n; k++) {
+            value -= m_cholesky[k*n + i]*m_weights[k];
+        }
+        m_weights[i] = value/m_cholesky[i*n + i];
+    }
+
+    m_fitted = true;
+    return true;
+}
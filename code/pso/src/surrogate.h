@@ -0,0 +1,52 @@
+/**************************************
+ * Declaration of the class Surrogate *
+ **************************************/
+
+#ifndef SURROGATE_H_
+#define SURROGATE_H_
+
+#include <vector>
+
+using namespace std;
+
+/**
+ * Gaussian process trained on the evaluations already done, used to predict the evaluation of a position
+ * without running argos. The positions are normalized in [0,1] with the bounds of the problem, the kernel
+ * is a squared exponential whose length scale is the median distance between the samples, and the noise of
+ * the simulations is a fixed fraction of the variance of the results.
+ * Only the last max_samples evaluations are kept, the model is fitted again when a prediction follows new samples.
+ */
+class Surrogate {
+
+public:
+
+    vector<double> m_lower_bounds;
+    vector<double> m_upper_bounds;
+    int m_max_samples;
+
+    vector<vector<double>> m_xs; // positions evaluated
+    vector<double> m_ys; // their evaluations
+
+    bool m_fitted;
+    double m_mean; // mean of the evaluations, the process models the difference to it
+    double m_variance; // variance of the evaluations
+    double m_length; // length scale of the kernel
+    vector<vector<double>> m_normalized; // positions of the samples in [0,1]
+    vector<double> m_cholesky; // lower triangular factor of the covariance matrix, row by row
+    vector<double> m_weights; // covariance matrix inverse times the centered evaluations
+
+    Surrogate(vector<double> * lower_bounds, vector<double> * upper_bounds, int max_samples);
+    ~Surrogate();
+
+    void add(vector<double> * x, double y); // Adds an evaluation done with argos
+    int size();
+    bool predict(const double * x, double * mean, double * deviation); // false while there aren't enough samples
+
+private:
+
+    void normalize(const double * x, vector<double> * normalized);
+    double kernel(vector<double> * a, vector<double> * b);
+    bool fit();
+};
+
+#endif
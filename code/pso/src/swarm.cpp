@@ -0,0 +1,291 @@
+/*************************************
+ * Implementation of the class Swarm *
+ *************************************/
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "swarm.h"
+#include "errors.h"
+
+using namespace std;
+
+#define ROW_ALIGNMENT 64 // bytes, one cache line
+#define CONSTRICTION 0.7298
+#define MIN_PARTICLES_PER_THREAD 32 // below this, waking a thread costs more than the moves it does
+
+Swarm::Swarm() {
+    m_problem = NULL;
+    m_nb_particles = 0;
+    m_size = 0;
+    m_stride = 0;
+    m_current = NULL;
+    m_velocity = NULL;
+    m_pBest = NULL;
+    m_lower_bounds = NULL;
+    m_upper_bounds = NULL;
+    m_nb_threads = 1;
+    m_function = NULL;
+    m_nb_ranges = 1;
+    m_round = 0;
+    m_nb_running = 0;
+    m_stop = false;
+}
+
+Swarm::~Swarm() {
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_round_started.notify_all();
+    for (int t = 0; t < m_threads.size(); t++) {
+        m_threads[t].join();
+    }
+    free(m_current);
+    free(m_velocity);
+    free(m_pBest);
+    free(m_lower_bounds);
+    free(m_upper_bounds);
+}
+
+bool Swarm::create(Problem * problem, int nb_particles) {
+    if (m_current != NULL) {
+        generateError("swarm.cpp","create","the swarm is already created");
+        return false;
+    }
+    if (nb_particles < 1) {
+        generateError("swarm.cpp","create","at least one particle is needed","nb_particles",nb_particles);
+        return false;
+    }
+
+    m_problem = problem;
+    m_nb_particles = nb_particles;
+    m_size = problem->getSize();
+    m_stride = (m_size + 7)/8*8;
+
+    m_current = allocateRows(m_nb_particles);
+    m_velocity = allocateRows(m_nb_particles);
+    m_pBest = allocateRows(m_nb_particles);
+    m_lower_bounds = allocateRows(1);
+    m_upper_bounds = allocateRows(1);
+    if (m_current == NULL || m_velocity == NULL || m_pBest == NULL || m_lower_bounds == NULL || m_upper_bounds == NULL) {
+        generateError("swarm.cpp","create","not enough memory for the swarm","nb_particles",nb_particles);
+        return false;
+    }
+
+    for (int i = 0; i < m_size; i++) {
+        m_lower_bounds[i] = problem->getLowerBound(i);
+        m_upper_bounds[i] = problem->getUpperBound(i);
+    }
+    m_eval.assign(m_nb_particles, 0.);
+    m_pBest_eval.assign(m_nb_particles, 0.);
+    m_neighbours.assign(m_nb_particles, vector<int>());
+    m_counters.assign(m_nb_particles, 0);
+
+    runInParallel(&Swarm::initializeRange);
+    return true;
+}
+
+void Swarm::set_nb_threads(int nb_threads) {
+    m_nb_threads = max(1, nb_threads);
+}
+
+// Rows filled with 0, the padding is never written again
+double* Swarm::allocateRows(int nb_rows) {
+    size_t bytes = nb_rows*m_stride*sizeof(double);
+    double * rows = (double *) aligned_alloc(ROW_ALIGNMENT, bytes);
+    if (rows != NULL) { memset(rows, 0, bytes); }
+    return rows;
+}
+
+void Swarm::initializeUniform(int particle) {
+    double * x = getCurrentPosition(particle);
+    double * pBest = getPBestPosition(particle);
+    for (int i = 0; i < m_size; i++) {
+        x[i] = m_problem->getRandomX(i, particle, &m_counters[particle]);
+        pBest[i] = x[i];
+    }
+    m_eval[particle] = 0;
+    m_pBest_eval[particle] = 0;
+}
+
+void Swarm::move(int particle) {
+    prepareRandom();
+    moveRange(particle, particle + 1);
+}
+
+// The particles are split in contiguous ranges, one per thread. A move only writes the rows of its own particle
+// and reads the personal bests, which aren't modified during the move, so every particle sees those of the
+// previous iteration and the threads never write the same data.
+void Swarm::moveAll() {
+    prepareRandom();
+    runInParallel(&Swarm::moveRange);
+}
+
+// Calls the function on contiguous ranges of particles, one range per thread. The number of ranges only depends
+// on the swarm, so the helper threads are started once and woken at every call, which allocates nothing.
+void Swarm::runInParallel(void (Swarm::*function)(int, int)) {
+    int nb_ranges = min(m_nb_threads, max(1, m_nb_particles/MIN_PARTICLES_PER_THREAD));
+    if (nb_ranges == 1) {
+        (this->*function)(0, m_nb_particles);
+        return;
+    }
+
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_nb_ranges = nb_ranges;
+        for (int t = m_threads.size() + 1; t < nb_ranges; t++) {
+            m_threads.push_back(thread(&Swarm::runRanges, this, t));
+        }
+        m_function = function;
+        m_nb_running = nb_ranges - 1;
+        m_round++;
+    }
+    m_round_started.notify_all();
+
+    (this->*function)(0, m_nb_particles/nb_ranges);
+
+    unique_lock<mutex> lock(m_mutex);
+    m_round_done.wait(lock, [this] { return m_nb_running == 0; });
+}
+
+void Swarm::runRanges(int range) {
+    int round = 0;
+    while (true) {
+        void (Swarm::*function)(int, int);
+        int nb_ranges;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_round_started.wait(lock, [this, round] { return m_stop || m_round != round; });
+            if (m_stop) { return; }
+            round = m_round;
+            function = m_function;
+            nb_ranges = m_nb_ranges;
+        }
+
+        if (range < nb_ranges) {
+            (this->*function)(m_nb_particles*range/nb_ranges, m_nb_particles*(range + 1)/nb_ranges);
+        }
+
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (range < nb_ranges) { m_nb_running--; }
+        }
+        m_round_done.notify_all();
+    }
+}
+
+void Swarm::initializeRange(int first, int last) {
+    for (int particle = first; particle < last; particle++) {
+        initializeUniform(particle);
+    }
+}
+
+// In each range, the random numbers are drawn first, then the kernels run over the whole rows
+void Swarm::moveRange(int first, int last) {
+    drawRandom(first, last);
+    pull(first, last);
+    constrict(first, last);
+}
+
+// Rows of random numbers of each particle, computed again when the topology changes
+void Swarm::prepareRandom() {
+    if (m_random_first.empty()) {
+        m_random_first.resize(m_nb_particles + 1);
+        m_random_first[0] = 0;
+        for (int particle = 0; particle < m_nb_particles; particle++) {
+            m_random_first[particle + 1] = m_random_first[particle] + m_neighbours[particle].size();
+        }
+        m_random.assign(m_random_first[m_nb_particles]*m_stride, 0.);
+    }
+}
+
+// One row per (particle, neighbour), drawn dimension by dimension from the stream of the particle
+void Swarm::drawRandom(int first, int last) {
+    for (int particle = first; particle < last; particle++) {
+        double * random = &m_random[m_random_first[particle]*m_stride];
+        int nb_neighbours = m_neighbours[particle].size();
+        for (int i = 0; i < m_size; i++) {
+            for (int j = 0; j < nb_neighbours; j++) {
+                random[j*m_stride + i] = m_problem->getRandom01(particle, &m_counters[particle]);
+            }
+        }
+    }
+}
+
+// velocity += 4/size * random * (neighbour's personal best - position), for every neighbour
+void Swarm::pull(int first, int last) {
+    const double coefficient = 4/(double)m_size;
+    const int stride = m_stride;
+
+    for (int particle = first; particle < last; particle++) {
+        double * __restrict__ v = getVelocity(particle);
+        const double * __restrict__ x = getCurrentPosition(particle);
+        const double * random = &m_random[m_random_first[particle]*stride];
+        int nb_neighbours = m_neighbours[particle].size();
+
+        for (int j = 0; j < nb_neighbours; j++) {
+            const double * __restrict__ r = random + j*stride;
+            const double * __restrict__ pBest = getPBestPosition(m_neighbours[particle][j]);
+            for (int i = 0; i < stride; i++) {
+                v[i] += coefficient*r[i]*(pBest[i] - x[i]);
+            }
+        }
+    }
+}
+
+// Constriction of the velocity, then the position is moved and clamped to the bounds. A clamped feature
+// loses its velocity. Written without branches so that the rows are updated with vector instructions.
+void Swarm::constrict(int first, int last) {
+    const int stride = m_stride;
+    const double * __restrict__ lower = m_lower_bounds;
+    const double * __restrict__ upper = m_upper_bounds;
+
+    for (int particle = first; particle < last; particle++) {
+        double * __restrict__ v = getVelocity(particle);
+        double * __restrict__ x = getCurrentPosition(particle);
+        for (int i = 0; i < stride; i++) {
+            double velocity = CONSTRICTION*v[i];
+            double position = x[i] + velocity;
+            double clamped = (position < lower[i] ? lower[i] : position);
+            clamped = (clamped > upper[i] ? upper[i] : clamped);
+            x[i] = clamped;
+            v[i] = (clamped == position ? velocity : 0.);
+        }
+    }
+}
+
+void Swarm::updatePBest(int particle) {
+    if (m_pBest_eval[particle] < m_eval[particle]) {
+        memcpy(getPBestPosition(particle), getCurrentPosition(particle), m_stride*sizeof(double));
+        m_pBest_eval[particle] = m_eval[particle];
+    }
+}
+
+double* Swarm::getCurrentPosition(int particle) {
+    return m_current + particle*m_stride;
+}
+
+double* Swarm::getPBestPosition(int particle) {
+    return m_pBest + particle*m_stride;
+}
+
+double* Swarm::getVelocity(int particle) {
+    return m_velocity + particle*m_stride;
+}
+
+void Swarm::addNeighbour(int particle, int neighbour) {
+    m_neighbours[particle].push_back(neighbour);
+    m_random_first.clear();
+}
+
+void Swarm::printPosition(int particle) {
+    double * x = getCurrentPosition(particle);
+	cout << "       Solution:" << m_eval[particle] << endl;
+    cout << "       ";
+	for (int i = 0; i < m_size; i++){
+		cout << x[i] << "  ";
+	}
+	cout << endl;
+}
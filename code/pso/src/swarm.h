@@ -0,0 +1,102 @@
+/**********************************
+ * Declaration of the class Swarm *
+ **********************************/
+
+#ifndef SWARM_H_
+#define SWARM_H_
+
+#include <vector>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "problem.h"
+
+using namespace std;
+
+// Solution structure
+struct Solution {
+	vector<double> x;
+	double eval;
+};
+
+/**
+ * Positions, velocities and personal bests of all the particles, stored as matrices with one row per particle.
+ * Rows are aligned on 64 bytes and padded to a multiple of 8 doubles, the padding stays at 0, so the kernels
+ * work on whole rows and the compiler vectorizes them. A particle is identified by its row.
+ * Each particle draws from its own random stream, so the moves can be split between threads and still give
+ * the same trajectory whatever the number of threads.
+ */
+class Swarm {
+
+public:
+
+    Problem* m_problem;
+    int m_nb_particles;
+    int m_size; // problem size
+    int m_stride; // doubles per row, padding included
+
+    double* m_current; // current positions
+    double* m_velocity;
+    double* m_pBest; // personal best positions
+    double* m_lower_bounds; // one padded row each
+    double* m_upper_bounds;
+    vector<double> m_eval; // evaluation of the current positions
+    vector<double> m_pBest_eval;
+
+    vector<vector<int>> m_neighbours;
+    vector<uint64_t> m_counters; // position of each particle in its random stream
+
+    int m_nb_threads; // threads used by moveAll
+    // Helper threads started by the first parallel call and kept until the swarm is destroyed, the calling thread
+    // takes the first range. A new round starts when m_round changes, m_nb_running counts the helpers not done yet.
+    vector<thread> m_threads;
+    void (Swarm::*m_function)(int, int);
+    int m_nb_ranges;
+    int m_round;
+    int m_nb_running;
+    bool m_stop;
+    mutex m_mutex;
+    condition_variable m_round_started;
+    condition_variable m_round_done;
+
+    vector<double> m_random; // random numbers of a move, one row per (particle, neighbour)
+    vector<int> m_random_first; // first row of each particle in m_random
+
+    Swarm();
+    ~Swarm();
+
+    bool create(Problem* problem, int nb_particles); // Allocates the matrices and draws random positions
+    void set_nb_threads(int nb_threads);
+
+    void initializeUniform(int particle); // Draws a random position, evaluated later
+    void move(int particle); // Moves one particle, the new position is evaluated later
+    void moveAll(); // Moves every particle according to the personal bests of the previous iteration
+    void updatePBest(int particle); // Called once the current position has been evaluated
+
+    double* getCurrentPosition(int particle);
+    double* getPBestPosition(int particle);
+    double* getVelocity(int particle);
+
+    // Modify topology
+    void addNeighbour(int particle, int neighbour);
+
+    // Verbose
+    void printPosition(int particle);
+
+private:
+
+    double* allocateRows(int nb_rows);
+    void prepareRandom();
+    void runInParallel(void (Swarm::*function)(int, int));
+    void runRanges(int range); // Loop executed by each helper thread, range identifies the thread
+    void initializeRange(int first, int last);
+    void moveRange(int first, int last);
+    void drawRandom(int first, int last);
+    void pull(int first, int last);
+    void constrict(int first, int last);
+};
+
+#endif
@@ -0,0 +1,123 @@
+/**************************************
+ * Implementation of the class Worker *
+ **************************************/
+
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "worker.h"
+#include "errors.h"
+
+using namespace std;
+
+Worker::Worker() {
+    m_pid = -1;
+    m_request = NULL;
+    m_answer = NULL;
+    m_started = false;
+}
+
+Worker::~Worker() {
+    stop();
+}
+
+// The worker runs "program directory slotDirectory templateFile", with its standard input and output connected to PSO
+bool Worker::start(string program, string directory, string slotDirectory, string templateFile) {
+    int requestPipe[2];
+    int answerPipe[2];
+
+    // Close on exec : the workers launched later must not keep the pipes of this one open
+    if (pipe2(requestPipe, O_CLOEXEC) != 0 || pipe2(answerPipe, O_CLOEXEC) != 0) {
+        generateError("worker.cpp","start","impossible to create the pipes");
+        return false;
+    }
+
+    // A dead worker must make evaluate() fail, not kill PSO
+    signal(SIGPIPE, SIG_IGN);
+
+    m_pid = fork();
+    if (m_pid < 0) {
+        generateError("worker.cpp","start","impossible to launch the worker","program",program);
+        return false;
+    }
+
+    if (m_pid == 0) {
+        dup2(requestPipe[0], STDIN_FILENO);
+        dup2(answerPipe[1], STDOUT_FILENO);
+        close(requestPipe[0]);
+        close(requestPipe[1]);
+        close(answerPipe[0]);
+        close(answerPipe[1]);
+        execl(program.c_str(), program.c_str(), directory.c_str(), slotDirectory.c_str(), templateFile.c_str(), (char *) NULL);
+        generateError("worker.cpp","start","impossible to execute the worker","program",program);
+        _exit(1);
+    }
+
+    close(requestPipe[0]);
+    close(answerPipe[1]);
+    m_request = fdopen(requestPipe[1], "w");
+    m_answer = fdopen(answerPipe[0], "r");
+    m_started = true;
+
+    return true;
+}
+
+// The socket is owned by the Worker from now on, stop() closes it
+bool Worker::attach(int socket) {
+    signal(SIGPIPE, SIG_IGN);
+
+    int writeSocket = dup(socket);
+    m_request = (writeSocket < 0 ? NULL : fdopen(writeSocket, "w"));
+    m_answer = fdopen(socket, "r");
+    if (m_request == NULL || m_answer == NULL) {
+        generateError("worker.cpp","attach","impossible to use the socket","socket",socket);
+        return false;
+    }
+    m_pid = -1;
+    m_started = true;
+
+    return true;
+}
+
+// experiment is "<scenario> <controller> <objective> <target objects>"
+bool Worker::evaluate(vector<double> * x, string experiment, int nb_robots, int seed, double * result) {
+    if (!m_started) {
+        generateError("worker.cpp","evaluate","the worker is not started");
+        return false;
+    }
+
+    fprintf(m_request, "EVAL %s %d %d", experiment.c_str(), nb_robots, seed);
+    for (int i = 0; i < x->size(); i++) {
+        fprintf(m_request, " %.17g", x->at(i));
+    }
+    fprintf(m_request, "\n");
+    fflush(m_request);
+
+    // A dead worker is stopped, so that it can be started again
+    char line[1024];
+    if (fgets(line, sizeof(line), m_answer) == NULL) {
+        generateError("worker.cpp","evaluate","the worker stopped answering","pid",m_pid);
+        stop();
+        return false;
+    }
+    if (sscanf(line, "OK %lf", result) != 1) {
+        line[strcspn(line, "\n")] = 0;
+        generateError("worker.cpp","evaluate","the worker could not evaluate the position","answer",line);
+        return false;
+    }
+
+    return true;
+}
+
+void Worker::stop() {
+    if (!m_started) { return; }
+
+    fprintf(m_request, "QUIT\n");
+    fclose(m_request);
+    fclose(m_answer);
+    if (m_pid > 0) { waitpid(m_pid, NULL, 0); }
+    m_started = false;
+}
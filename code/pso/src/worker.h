@@ -0,0 +1,45 @@
+/***********************************
+ * Declaration of the class Worker *
+ ***********************************/
+
+#ifndef WORKER_H_
+#define WORKER_H_
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <sys/types.h>
+
+using namespace std;
+
+/**
+ * Client side of a foraging_worker process : the worker keeps an argos simulator loaded and answers
+ * evaluation requests written on its standard input. The protocol is one line per message :
+ *
+ *   request : EVAL <scenario> <controller> <objective> <target objects> <nb_robots> <seed> <x_1> ... <x_n>
+ *   answer  : OK <result of the objective>   or   ERROR <message>
+ *
+ * The scenario, controller, objective and target objects (the experiment) are the ones of the PSO run : a
+ * worker or node set up for another experiment answers ERROR instead of running it. QUIT stops the worker.
+ * The same protocol is spoken over TCP with the PSO nodes of a distributed run (see coordinator.h),
+ * the connection is then attached to the Worker instead of a process.
+ */
+class Worker {
+
+public:
+
+    pid_t m_pid;
+    FILE* m_request; // standard input of the worker
+    FILE* m_answer; // standard output of the worker
+    bool m_started;
+
+    Worker();
+    ~Worker();
+
+    bool start(string program, string directory, string slotDirectory, string templateFile); // Launches the worker process
+    bool attach(int socket); // Uses a connected socket instead of a process
+    bool evaluate(vector<double> * x, string experiment, int nb_robots, int seed, double * result); // Sends one request and waits for the answer, stops the worker if it doesn't answer
+    void stop();
+};
+
+#endif
@@ -1,10 +1,14 @@
 #include "foraging.h"
 
 #include <argos3/plugins/simulator/entities/cylinder_entity.h>
+#include <argos3/plugins/simulator/entities/box_entity.h>
+#include <argos3/core/simulator/physics_engine/physics_engine.h>
+#include <argos3/core/simulator/simulator.h>
 
 #include <algorithm>
 #include <cstring>
 #include <cerrno>
+#include <cstdlib>
 
 #include <vector>
 #include <fstream>
@@ -21,6 +25,28 @@ static const Real CONSTRUCTION_AREA_MAX_X  = 5.6f;
 static const Real CONSTRUCTION_AREA_MIN_Y  = -1.625f;
 static const Real CONSTRUCTION_AREA_MAX_Y  = 1.625f;
 
+static const Real  FLOOR_CELL_SIZE         = 0.05f;
+static const Real  FLOOR_CELL_MARGIN       = 1e-6f;
+static const UInt8 FLOOR_MIXED_REGION      = 255;
+
+static const UInt32 OBJECTIVE_OBJECTS      = 0;
+static const UInt32 OBJECTIVE_AUC          = 1;
+static const UInt32 OBJECTIVE_TIME         = 2;
+
+static const UInt32 CONTROLLER_PARAMETERS  = 8;
+
+static const UInt32 METRICS_FIXED_COLUMNS  = 4;
+static const UInt32 METRICS_MAX_STATES     = 32;
+static const UInt32 METRICS_ROW_SIZE       = METRICS_FIXED_COLUMNS + METRICS_MAX_STATES;
+
+/* Region the robots are placed in on a reset, and the room a robot takes there */
+static const Real PLACEMENT_MIN_X          = 1.5f;
+static const Real PLACEMENT_MAX_X          = 5.5f;
+static const Real PLACEMENT_MIN_Y          = -2.0f;
+static const Real PLACEMENT_MAX_Y          = 2.0f;
+static const Real FOOTBOT_RADIUS           = 0.085036758f;
+static const Real PLACEMENT_CLEARANCE      = 0.02f;
+
 /****************************************/
 /****************************************/
 
@@ -34,6 +60,22 @@ CForaging::CForaging() :
    m_cDarkGrayRange(0.05f, 0.55f),
    m_cLightGrayRange(0.50f, 0.90f),
    m_bResetAll(false),
+   m_strOutputFile("output/outputArgos.csv"),
+   m_strParametersFile("input/parameters.csv"),
+   m_unObjective(OBJECTIVE_OBJECTS),
+   m_unTargetObjects(0),
+   m_unDeliveredSum(0),
+   m_unTargetStep(0),
+   m_bStopWhenDelivered(false),
+   m_bFinished(false),
+   m_unObjectsInArea(0),
+   m_unObjectsInCache(0),
+   m_unMetricsEvery(10),
+   m_unFloorColumns(0),
+   m_unFloorRows(0),
+   m_vecFloorPalette(1, CColor::WHITE),
+   m_unPlacementColumns(1),
+   m_unPlacementRows(1),
    m_pcRNG(NULL) {
 }
 
@@ -48,6 +90,7 @@ CForaging::~CForaging() {
 /****************************************/
 
 void CForaging::Init(TConfigurationNode& t_tree) {
+   std::string strObjective = "objects";
    try {
       TConfigurationNode& tForaging = GetNode(t_tree, "params");
 
@@ -57,12 +100,92 @@ void CForaging::Init(TConfigurationNode& t_tree) {
       GetNodeAttribute(tForaging, "min_cache_y", m_fMinCacheY);
       GetNodeAttribute(tForaging, "max_cache_y", m_fMaxCacheY);
       GetNodeAttribute(tForaging, "reset_all", m_bResetAll);
-      
+      GetNodeAttributeOrDefault(tForaging, "output_file", m_strOutputFile, m_strOutputFile);
+      GetNodeAttributeOrDefault(tForaging, "parameters_file", m_strParametersFile, m_strParametersFile);
+      GetNodeAttributeOrDefault(tForaging, "stop_when_delivered", m_bStopWhenDelivered, m_bStopWhenDelivered);
+      GetNodeAttributeOrDefault(tForaging, "metrics_file", m_strMetricsFile, m_strMetricsFile);
+      GetNodeAttributeOrDefault(tForaging, "metrics_every", m_unMetricsEvery, m_unMetricsEvery);
+      GetNodeAttributeOrDefault(tForaging, "objective", strObjective, strObjective);
+      GetNodeAttributeOrDefault(tForaging, "target_objects", m_unTargetObjects, m_unTargetObjects);
+
+      /* The construction area has priority over the cache area, then come the other areas of the XML */
+      SFloorArea sTarget = {CONSTRUCTION_AREA_MIN_X, CONSTRUCTION_AREA_MAX_X, CONSTRUCTION_AREA_MIN_Y, CONSTRUCTION_AREA_MAX_Y, true};
+      SFloorArea sCache = {m_fMinCacheX, m_fMaxCacheX, m_fMinCacheY, m_fMaxCacheY, false};
+      m_vecFloorAreas.clear();
+      m_vecFloorAreas.push_back(sTarget);
+      m_vecFloorAreas.push_back(sCache);
+      TConfigurationNodeIterator itArea("area");
+      for(itArea = itArea.begin(&tForaging); itArea != itArea.end(); ++itArea) {
+         SFloorArea sArea;
+         std::string strType;
+         GetNodeAttribute(*itArea, "type", strType);
+         GetNodeAttribute(*itArea, "min_x", sArea.MinX);
+         GetNodeAttribute(*itArea, "max_x", sArea.MaxX);
+         GetNodeAttribute(*itArea, "min_y", sArea.MinY);
+         GetNodeAttribute(*itArea, "max_y", sArea.MaxY);
+         if(strType != "target" && strType != "cache") {
+            THROW_ARGOSEXCEPTION("Unknown area type \"" << strType << "\", expected target or cache");
+         }
+         sArea.Target = (strType == "target");
+         m_vecFloorAreas.push_back(sArea);
+      }
+      if(m_vecFloorAreas.size() >= FLOOR_MIXED_REGION) {
+         THROW_ARGOSEXCEPTION("Too many floor areas");
+      }
    }
    catch(CARGoSException& ex) {
       THROW_ARGOSEXCEPTION_NESTED("Error parsing loop functions!", ex);
    }
 
+   /* The environment overrides the XML, so that every PSO run gets its own output file */
+   const char* pchOutputFile = ::getenv("FORAGING_OUTPUT");
+   if(pchOutputFile != NULL) {
+      m_strOutputFile = pchOutputFile;
+   }
+   const char* pchMetricsFile = ::getenv("FORAGING_METRICS");
+   if(pchMetricsFile != NULL) {
+      m_strMetricsFile = pchMetricsFile;
+   }
+   /* PSO chooses the objective of its runs through the environment too */
+   const char* pchObjective = ::getenv("FORAGING_OBJECTIVE");
+   if(pchObjective != NULL) {
+      strObjective = pchObjective;
+   }
+   const char* pchTargetObjects = ::getenv("FORAGING_TARGET_OBJECTS");
+   if(pchTargetObjects != NULL) {
+      m_unTargetObjects = ::atoi(pchTargetObjects);
+   }
+   if(strObjective == "objects") {
+      m_unObjective = OBJECTIVE_OBJECTS;
+   }
+   else if(strObjective == "auc") {
+      m_unObjective = OBJECTIVE_AUC;
+   }
+   else if(strObjective == "time") {
+      m_unObjective = OBJECTIVE_TIME;
+   }
+   else {
+      THROW_ARGOSEXCEPTION("Unknown objective \"" << strObjective << "\", expected objects, auc or time");
+   }
+   if(m_unMetricsEvery == 0) {
+      THROW_ARGOSEXCEPTION("metrics_every must be at least 1");
+   }
+
+   TrackObjects();
+   TrackRobots();
+   LoadControllerParameters();
+   BuildFloor();
+
+   /* By default the target is every object of the arena */
+   if(m_unTargetObjects == 0) {
+      m_unTargetObjects = m_vecObjects.size();
+   }
+
+   /* The rows of a whole experiment are allocated once */
+   if(!m_strMetricsFile.empty()) {
+      m_vecMetrics.reserve((CSimulator::GetInstance().GetMaxSimulationClock() / m_unMetricsEvery + 2) * METRICS_ROW_SIZE);
+   }
+
    m_pcRNG = CRandom::CreateRNG("argos");
    
    Real fFirstColor = m_pcRNG->Uniform(m_cDarkGrayRange);
@@ -84,14 +207,20 @@ void CForaging::Init(TConfigurationNode& t_tree) {
          m_fTargetValue = fFirstColor;
       }
    }
+   UpdateFloorPalette();
 }
 
 /****************************************/
 /****************************************/
 
 void CForaging::Reset() {
-   /* Nothing to do */
    m_vecConstructionObjectsInArea.clear();
+   TrackObjects();
+   LoadControllerParameters();
+   m_vecMetrics.clear();
+   m_unDeliveredSum = 0;
+   m_unTargetStep = 0;
+   m_bFinished = false;
 
    if (m_bResetAll)
    {
@@ -115,6 +244,7 @@ void CForaging::Reset() {
          }
       }
 
+      UpdateFloorPalette();
       MoveRobots();
    }
 }
@@ -123,7 +253,10 @@ void CForaging::Reset() {
 /****************************************/
 
 void CForaging::Destroy() {
-   /* Nothing to do */
+   for(size_t i = 0; i < m_vecSensorDigests.size(); ++i) {
+      delete m_vecSensorDigests[i];
+   }
+   m_vecSensorDigests.clear();
 }
 
 /****************************************/
@@ -136,8 +269,43 @@ void CForaging::PreStep() {
 /****************************************/
 /****************************************/
 
+/*
+ * The time objective is decided once the target is reached, the experiment then stops unless the
+ * metrics are recorded. The opt-in stop_when_delivered rule stops the experiment once every object
+ * is in the construction area: the result is the one of a full-length run as long as no robot
+ * takes an object out of the area afterwards, which the controllers never do on purpose.
+ */
 void CForaging::PostStep() {
+   bool bRules = m_bStopWhenDelivered;
+   bool bSample = (!m_strMetricsFile.empty() && GetSpace().GetSimulationClock() % m_unMetricsEvery == 0);
+   bool bAnytime = (m_unObjective != OBJECTIVE_OBJECTS);
+   if(!bRules && !bSample && !bAnytime) {
+      return;
+   }
+
+   UpdateObjects();
+   if(bAnytime) {
+      m_unDeliveredSum += m_unObjectsInArea;
+      if(m_unTargetStep == 0 && m_unObjectsInArea >= m_unTargetObjects) {
+         m_unTargetStep = GetSpace().GetSimulationClock();
+      }
+   }
+   if(bSample) {
+      SampleMetrics();
+   }
+   if(m_unObjective == OBJECTIVE_TIME && m_unTargetStep > 0 && m_strMetricsFile.empty()) {
+      m_bFinished = true;
+   }
+   if(m_bStopWhenDelivered && m_unObjectsInArea == m_vecObjects.size()) {
+      m_bFinished = true;
+   }
+}
+
+/****************************************/
+/****************************************/
 
+bool CForaging::IsExperimentFinished() {
+   return m_bFinished;
 }
 
 /****************************************/
@@ -145,8 +313,9 @@ void CForaging::PostStep() {
 
 void CForaging::PostExperiment() {
     FilterObjects();
+    Real fResult = ComputeObjective();
 
-    std::string const myFile("output/outputArgos.csv");
+    std::string const myFile(m_strOutputFile);
     std::ofstream myInitializer(myFile.c_str());
 
     myInitializer << "";
@@ -154,39 +323,147 @@ void CForaging::PostExperiment() {
     std::ofstream myStream(myFile.c_str(), std::ios::app);
 
     if (myStream) {
-        myStream << std::to_string(m_vecConstructionObjectsInArea.size()) << std::endl;
+        if(m_unObjective == OBJECTIVE_OBJECTS) {
+           myStream << std::to_string(m_vecConstructionObjectsInArea.size()) << std::endl;
+        }
+        else {
+           myStream << std::to_string(fResult) << std::endl;
+        }
         LOG << "[INFO] Writing results finished without errors" << std::endl;
         LOG << "[INFO] Objects: " << m_vecConstructionObjectsInArea.size() << std::endl;
+        LOG << "[INFO] Objective: " << fResult << std::endl;
     }
     else {
-        LOG << "[ERROR] Can't open file : " << "output.csv" << std::endl;
+        LOG << "[ERROR] Can't open file : " << myFile << std::endl;
+    }
+
+    if(!m_strMetricsFile.empty()) {
+       WriteMetrics();
     }
 }
 
 /****************************************/
 /****************************************/
 
+/*
+ * An experiment stopped early by a rule ends with the objects where they are, so the steps it
+ * didn't simulate count with the last number of objects in the construction area.
+ */
+Real CForaging::ComputeObjective() {
+   if(m_unObjective == OBJECTIVE_OBJECTS) {
+      return m_vecConstructionObjectsInArea.size();
+   }
+
+   UInt32 unLength = CSimulator::GetInstance().GetMaxSimulationClock();
+   UInt32 unClock = GetSpace().GetSimulationClock();
+   if(unLength < unClock) {
+      unLength = unClock;
+   }
+   if(unLength == 0) {
+      return 0.0f;
+   }
+
+   if(m_unObjective == OBJECTIVE_AUC) {
+      UInt64 unSum = m_unDeliveredSum + static_cast<UInt64>(unLength - unClock) * m_unObjectsInArea;
+      return static_cast<Real>(unSum) / unLength;
+   }
+
+   /* The target may be reached by the last state of an experiment stopped early */
+   UInt32 unTargetStep = m_unTargetStep;
+   if(unTargetStep == 0 && m_unObjectsInArea >= m_unTargetObjects) {
+      unTargetStep = unClock;
+   }
+   if(unTargetStep == 0) {
+      return 0.0f;
+   }
+   return (unLength - unTargetStep) * CPhysicsEngine::GetSimulationClockTick();
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The ground sensors of every robot and the floor texture ask for colours all the time, while
+ * the areas never move: the region of a point comes from the raster built in Init(), and its
+ * colour from the palette. Only the cells crossed by a border test the point against the areas.
+ */
 CColor CForaging::GetFloorColor(const CVector2& c_position_on_plane) {
-   /* Check if the given point is within the construction area */
-   if(c_position_on_plane.GetX() >= CONSTRUCTION_AREA_MIN_X &&
-      c_position_on_plane.GetX() <= CONSTRUCTION_AREA_MAX_X &&
-      c_position_on_plane.GetY() >= CONSTRUCTION_AREA_MIN_Y &&
-      c_position_on_plane.GetY() <= CONSTRUCTION_AREA_MAX_Y) {
-      /* Yes, it is - return darker gray */
-      return CColor(m_fTargetValue*255, m_fTargetValue*255, m_fTargetValue*255);
-   }
-
-   /* Check if the given point is within the cache area */
-   if(c_position_on_plane.GetX() >= m_fMinCacheX &&
-      c_position_on_plane.GetX() <= m_fMaxCacheX &&
-      c_position_on_plane.GetY() >= m_fMinCacheY &&
-      c_position_on_plane.GetY() <= m_fMaxCacheY) {
-      /* Yes, it is - return lighter gray */
-      return CColor(m_fCacheValue*255, m_fCacheValue*255, m_fCacheValue*255);
-   }
-
-   /* No, it isn't - return white */
-   return CColor::WHITE;
+   Real fColumn = Floor((c_position_on_plane.GetX() - m_cFloorOrigin.GetX()) / FLOOR_CELL_SIZE);
+   Real fRow = Floor((c_position_on_plane.GetY() - m_cFloorOrigin.GetY()) / FLOOR_CELL_SIZE);
+   UInt8 unRegion = FLOOR_MIXED_REGION;
+   if(fColumn >= 0 && fColumn < m_unFloorColumns && fRow >= 0 && fRow < m_unFloorRows) {
+      unRegion = m_vecFloorRegions[static_cast<UInt32>(fRow) * m_unFloorColumns + static_cast<UInt32>(fColumn)];
+   }
+   if(unRegion == FLOOR_MIXED_REGION) {
+      unRegion = GetFloorRegion(c_position_on_plane);
+   }
+   return m_vecFloorPalette[unRegion];
+}
+
+/****************************************/
+/****************************************/
+
+UInt8 CForaging::GetFloorRegion(const CVector2& c_position_on_plane) {
+   for(size_t i = 0; i < m_vecFloorAreas.size(); ++i) {
+      const SFloorArea& sArea = m_vecFloorAreas[i];
+      if(c_position_on_plane.GetX() >= sArea.MinX &&
+         c_position_on_plane.GetX() <= sArea.MaxX &&
+         c_position_on_plane.GetY() >= sArea.MinY &&
+         c_position_on_plane.GetY() <= sArea.MaxY) {
+         return i + 1;
+      }
+   }
+   return 0;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The cells are enlarged by a small margin when they are classified, so that the rounding of
+ * the cell index of a point near a cell border can't give it the region of the neighbour cell.
+ */
+void CForaging::BuildFloor() {
+   const CVector3& cArenaSize = GetSpace().GetArenaSize();
+   const CVector3& cArenaCenter = GetSpace().GetArenaCenter();
+   m_cFloorOrigin.Set(cArenaCenter.GetX() - cArenaSize.GetX() / 2.0f,
+                      cArenaCenter.GetY() - cArenaSize.GetY() / 2.0f);
+   m_unFloorColumns = static_cast<UInt32>(Ceil(cArenaSize.GetX() / FLOOR_CELL_SIZE));
+   m_unFloorRows = static_cast<UInt32>(Ceil(cArenaSize.GetY() / FLOOR_CELL_SIZE));
+   m_vecFloorRegions.assign(m_unFloorColumns * m_unFloorRows, 0);
+
+   for(UInt32 unRow = 0; unRow < m_unFloorRows; ++unRow) {
+      Real fMinY = m_cFloorOrigin.GetY() + unRow * FLOOR_CELL_SIZE - FLOOR_CELL_MARGIN;
+      Real fMaxY = fMinY + FLOOR_CELL_SIZE + 2.0f * FLOOR_CELL_MARGIN;
+      for(UInt32 unColumn = 0; unColumn < m_unFloorColumns; ++unColumn) {
+         Real fMinX = m_cFloorOrigin.GetX() + unColumn * FLOOR_CELL_SIZE - FLOOR_CELL_MARGIN;
+         Real fMaxX = fMinX + FLOOR_CELL_SIZE + 2.0f * FLOOR_CELL_MARGIN;
+         /* The first area touching the cell decides, if it covers the whole cell */
+         UInt8 unRegion = 0;
+         for(size_t i = 0; i < m_vecFloorAreas.size(); ++i) {
+            const SFloorArea& sArea = m_vecFloorAreas[i];
+            if(fMaxX < sArea.MinX || fMinX > sArea.MaxX || fMaxY < sArea.MinY || fMinY > sArea.MaxY) {
+               continue;
+            }
+            bool bCovered = (fMinX >= sArea.MinX && fMaxX <= sArea.MaxX && fMinY >= sArea.MinY && fMaxY <= sArea.MaxY);
+            unRegion = (bCovered ? i + 1 : FLOOR_MIXED_REGION);
+            break;
+         }
+         m_vecFloorRegions[unRow * m_unFloorColumns + unColumn] = unRegion;
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForaging::UpdateFloorPalette() {
+   m_vecFloorPalette.resize(m_vecFloorAreas.size() + 1);
+   m_vecFloorPalette[0] = CColor::WHITE;
+   for(size_t i = 0; i < m_vecFloorAreas.size(); ++i) {
+      Real fValue = (m_vecFloorAreas[i].Target ? m_fTargetValue : m_fCacheValue);
+      m_vecFloorPalette[i + 1] = CColor(fValue*255, fValue*255, fValue*255);
+   }
 }
 
 /****************************************/
@@ -201,60 +478,380 @@ void CForaging::FilterObjects() {
    /* Clear list of positions of objects in construction area */
    m_vecConstructionObjectsInArea.clear();
 
-   /* Get the list of cylinders from the ARGoS space */
+   /* Bring the tracked objects up to date and collect the ones in the target area */
+   UpdateObjects();
+   for(size_t i = 0; i < m_vecObjects.size(); ++i) {
+      if(m_vecObjects[i].InArea) {
+         m_vecConstructionObjectsInArea.push_back(m_vecObjects[i].Position);
+      }
+   }
+
+}
+
+/****************************************/
+/****************************************/
+
+void CForaging::TrackObjects() {
+   m_vecObjects.clear();
+   m_unObjectsInArea = 0;
+   m_unObjectsInCache = 0;
+
+   /* Get the list of cylinders from the ARGoS space, only this once */
    CSpace::TMapPerType& tCylinderMap = GetSpace().GetEntitiesByType("cylinder");
-   /* Go through the list and collect data */
    for(CSpace::TMapPerType::iterator it = tCylinderMap.begin();
        it != tCylinderMap.end();
        ++it) {
-      /* Get a reference to the object body */
-      CEmbodiedEntity& cBody = any_cast<CCylinderEntity*>(it->second)->GetEmbodiedEntity();
-      /* Check if object is in target area */
-      if(cBody.GetOriginAnchor().Position.GetX() > CONSTRUCTION_AREA_MIN_X &&
-         cBody.GetOriginAnchor().Position.GetX() < CONSTRUCTION_AREA_MAX_X &&
-         cBody.GetOriginAnchor().Position.GetY() > CONSTRUCTION_AREA_MIN_Y &&
-         cBody.GetOriginAnchor().Position.GetY() < CONSTRUCTION_AREA_MAX_Y) {
-         /* Yes, it is */
-         /* Add it to the list */
-         m_vecConstructionObjectsInArea.push_back(cBody.GetOriginAnchor().Position);
+      SObject sObject;
+      sObject.Body = &any_cast<CCylinderEntity*>(it->second)->GetEmbodiedEntity();
+      sObject.Position = sObject.Body->GetOriginAnchor().Position;
+      sObject.InArea = IsInConstructionArea(sObject.Position);
+      sObject.InCache = IsInCacheArea(sObject.Position);
+      if(sObject.InArea) {
+         ++m_unObjectsInArea;
+      }
+      if(sObject.InCache) {
+         ++m_unObjectsInCache;
       }
+      m_vecObjects.push_back(sObject);
    }
+}
 
+/****************************************/
+/****************************************/
+
+/*
+ * Most objects lie still at any given step: a still object costs one comparison of
+ * its position, only the moved ones are tested against the construction area.
+ */
+UInt32 CForaging::UpdateObjects() {
+   UInt32 unMoved = 0;
+   for(size_t i = 0; i < m_vecObjects.size(); ++i) {
+      SObject& sObject = m_vecObjects[i];
+      const CVector3& cPosition = sObject.Body->GetOriginAnchor().Position;
+      if(cPosition == sObject.Position) {
+         continue;
+      }
+      ++unMoved;
+      sObject.Position = cPosition;
+      bool bInArea = IsInConstructionArea(cPosition);
+      if(bInArea != sObject.InArea) {
+         sObject.InArea = bInArea;
+         if(bInArea) {
+            ++m_unObjectsInArea;
+         }
+         else {
+            --m_unObjectsInArea;
+         }
+      }
+      bool bInCache = IsInCacheArea(cPosition);
+      if(bInCache != sObject.InCache) {
+         sObject.InCache = bInCache;
+         if(bInCache) {
+            ++m_unObjectsInCache;
+         }
+         else {
+            --m_unObjectsInCache;
+         }
+      }
+   }
+   return unMoved;
+}
+
+/****************************************/
+/****************************************/
+
+void CForaging::TrackRobots() {
+   m_vecRobotBodies.clear();
+   m_vecRobotLuaStates.clear();
+   m_vecRobotControllers.clear();
+   for(size_t i = 0; i < m_vecSensorDigests.size(); ++i) {
+      delete m_vecSensorDigests[i];
+   }
+   m_vecSensorDigests.clear();
+
+   CSpace::TMapPerType& tFootBotMap = GetSpace().GetEntitiesByType("foot-bot");
+   for(CSpace::TMapPerType::iterator it = tFootBotMap.begin();
+       it != tFootBotMap.end();
+       ++it) {
+      CFootBotEntity* pcFootBot = any_cast<CFootBotEntity*>(it->second);
+      CCI_Controller* pcController = &pcFootBot->GetControllableEntity().GetController();
+      CLuaController* pcLuaController = dynamic_cast<CLuaController*>(pcController);
+      m_vecRobotBodies.push_back(&pcFootBot->GetEmbodiedEntity());
+      m_vecRobotLuaStates.push_back(pcLuaController != NULL ? pcLuaController->GetLuaState() : NULL);
+      m_vecRobotControllers.push_back(dynamic_cast<CForagingController*>(pcController));
+      if(pcLuaController != NULL && pcLuaController->GetLuaState() != NULL && CSensorDigest::CanDigest(*pcController)) {
+         m_vecSensorDigests.push_back(new CSensorDigest(*pcController));
+         m_vecSensorDigests.back()->Register(pcLuaController->GetLuaState());
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The file is read again at every reset, the in-process PSO engine changes it between two
+ * experiments. Each line must hold a number, as the lua script expects.
+ */
+void CForaging::LoadControllerParameters() {
+   std::string strFile = m_strParametersFile;
+   const char* pchFile = ::getenv("FORAGING_PARAMETERS");
+   if(pchFile != NULL) {
+      strFile = pchFile;
+   }
+
+   m_vecControllerParameters.clear();
+   std::ifstream cStream(strFile.c_str());
+   std::string strLine;
+   while(m_vecControllerParameters.size() < CONTROLLER_PARAMETERS && std::getline(cStream, strLine)) {
+      char* pchEnd;
+      Real fValue = ::strtod(strLine.c_str(), &pchEnd);
+      if(pchEnd == strLine.c_str()) {
+         break;
+      }
+      m_vecControllerParameters.push_back(fValue);
+   }
+   if(m_vecControllerParameters.size() < CONTROLLER_PARAMETERS) {
+      LOG << "[WARNING] Can't read the controller parameters in " << strFile
+             << ", the controllers will read it themselves" << std::endl;
+      m_vecControllerParameters.clear();
+   }
+   PushControllerParameters();
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The lua controllers get the values in the global table PUSHED_PARAMETERS, which
+ * load_parameters() uses instead of the file. Controllers without parameters ignore it.
+ */
+void CForaging::PushControllerParameters() {
+   for(size_t i = 0; i < m_vecRobotBodies.size(); ++i) {
+      if(m_vecRobotControllers[i] != NULL) {
+         m_vecRobotControllers[i]->SetParameters(m_vecControllerParameters);
+      }
+      lua_State* ptLuaState = m_vecRobotLuaStates[i];
+      if(ptLuaState == NULL) {
+         continue;
+      }
+      if(m_vecControllerParameters.empty()) {
+         lua_pushnil(ptLuaState);
+      }
+      else {
+         lua_createtable(ptLuaState, m_vecControllerParameters.size(), 0);
+         for(size_t j = 0; j < m_vecControllerParameters.size(); ++j) {
+            lua_pushnumber(ptLuaState, m_vecControllerParameters[j]);
+            lua_rawseti(ptLuaState, -2, j + 1);
+         }
+      }
+      lua_setglobal(ptLuaState, "PUSHED_PARAMETERS");
+   }
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The states are found while the experiment runs, each one gets the next column the first time
+ * a robot is seen in it. The lua states and the native controllers are only read, the controllers
+ * are not disturbed.
+ */
+void CForaging::SampleMetrics() {
+   size_t unRow = m_vecMetrics.size();
+   m_vecMetrics.resize(unRow + METRICS_ROW_SIZE, 0);
+   UInt32* punRow = &m_vecMetrics[unRow];
+   punRow[0] = GetSpace().GetSimulationClock();
+   punRow[1] = m_unObjectsInArea;
+   punRow[2] = m_unObjectsInCache;
+   punRow[3] = 0;
+
+   for(size_t i = 0; i < m_vecRobotBodies.size(); ++i) {
+      if(m_vecRobotBodies[i]->IsCollidingWithSomething()) {
+         ++punRow[3];
+      }
+
+      lua_State* ptLuaState = m_vecRobotLuaStates[i];
+      const char* pchState = NULL;
+      if(m_vecRobotControllers[i] != NULL) {
+         pchState = m_vecRobotControllers[i]->GetStateName();
+      }
+      else if(ptLuaState != NULL) {
+         lua_getglobal(ptLuaState, "STATE");
+         pchState = (lua_type(ptLuaState, -1) == LUA_TSTRING ? lua_tostring(ptLuaState, -1) : NULL);
+      }
+      if(pchState != NULL) {
+         size_t unState = 0;
+         while(unState < m_vecMetricsStates.size() && m_vecMetricsStates[unState] != pchState) {
+            ++unState;
+         }
+         if(unState == m_vecMetricsStates.size() && unState < METRICS_MAX_STATES) {
+            m_vecMetricsStates.push_back(pchState);
+         }
+         if(unState < METRICS_MAX_STATES) {
+            ++punRow[METRICS_FIXED_COLUMNS + unState];
+         }
+      }
+      if(m_vecRobotControllers[i] == NULL && ptLuaState != NULL) {
+         lua_pop(ptLuaState, 1);
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * File layout: a text line "FORAGING_METRICS 1", a text line "<columns> <rows>", a text line with
+ * the names of the columns separated by spaces, then the rows as unsigned 32-bit integers in the
+ * byte order of the machine. In R: readLines(con, 3) then readBin(con, "integer", size = 4, n = ...).
+ */
+void CForaging::WriteMetrics() {
+   UInt32 unColumns = METRICS_FIXED_COLUMNS + m_vecMetricsStates.size();
+   UInt32 unRows = m_vecMetrics.size() / METRICS_ROW_SIZE;
+
+   std::ofstream cStream(m_strMetricsFile.c_str(), std::ios::binary | std::ios::trunc);
+   if(!cStream) {
+      LOG << "[ERROR] Can't open file : " << m_strMetricsFile << std::endl;
+      return;
+   }
+   cStream << "FORAGING_METRICS 1\n" << unColumns << " " << unRows << "\n";
+   cStream << "step delivered in_cache colliding";
+   for(size_t i = 0; i < m_vecMetricsStates.size(); ++i) {
+      cStream << " " << m_vecMetricsStates[i];
+   }
+   cStream << "\n";
+   for(UInt32 unRow = 0; unRow < unRows; ++unRow) {
+      cStream.write(reinterpret_cast<const char*>(&m_vecMetrics[unRow * METRICS_ROW_SIZE]), unColumns * sizeof(UInt32));
+   }
+}
+
+/****************************************/
+/****************************************/
+
+bool CForaging::IsInConstructionArea(const CVector3& c_position) {
+   return c_position.GetX() > CONSTRUCTION_AREA_MIN_X &&
+          c_position.GetX() < CONSTRUCTION_AREA_MAX_X &&
+          c_position.GetY() > CONSTRUCTION_AREA_MIN_Y &&
+          c_position.GetY() < CONSTRUCTION_AREA_MAX_Y;
+}
+
+/****************************************/
+/****************************************/
+
+bool CForaging::IsInCacheArea(const CVector3& c_position) {
+   return c_position.GetX() > m_fMinCacheX &&
+          c_position.GetX() < m_fMaxCacheX &&
+          c_position.GetY() > m_fMinCacheY &&
+          c_position.GetY() < m_fMaxCacheY;
 }
 
 /****************************************/
 /****************************************/
 
 void CForaging::MoveRobots() {
-  CFootBotEntity* pcFootBot;
-  bool bPlaced = false;
-  UInt32 unTrials;
-  CSpace::TMapPerType& tFootBotMap = GetSpace().GetEntitiesByType("foot-bot");
-  for (CSpace::TMapPerType::iterator it = tFootBotMap.begin(); it != tFootBotMap.end(); ++it) {
-    pcFootBot = any_cast<CFootBotEntity*>(it->second);
-    // Choose position at random
-    unTrials = 0;
-    do {
-       ++unTrials;
-       CVector3 cFootBotPosition = GetRandomPosition();
-       bPlaced = MoveEntity(pcFootBot->GetEmbodiedEntity(),
-                            cFootBotPosition,
-                            CQuaternion().FromEulerAngles(m_pcRNG->Uniform(CRange<CRadians>(CRadians::ZERO,CRadians::TWO_PI)),
-                            CRadians::ZERO,CRadians::ZERO),false);
-    } while(!bPlaced && unTrials < 1000);
-    if(!bPlaced) {
-       THROW_ARGOSEXCEPTION("Can't place robot");
-    }
-  }
+   CSpace::TMapPerType& tFootBotMap = GetSpace().GetEntitiesByType("foot-bot");
+   UInt32 unRobots = tFootBotMap.size();
+   FindPlacementCells(unRobots);
+
+   /* Every robot takes a random free cell, the cells moved to the front are the ones already taken */
+   UInt32 unTaken = 0;
+   UInt32 unTrials = 0;
+   for(CSpace::TMapPerType::iterator it = tFootBotMap.begin(); it != tFootBotMap.end(); ++it) {
+      CFootBotEntity* pcFootBot = any_cast<CFootBotEntity*>(it->second);
+      bool bPlaced = false;
+      while(!bPlaced) {
+         if(unTaken == m_vecPlacementCells.size() || unTrials == 2 * m_vecPlacementCells.size()) {
+            THROW_ARGOSEXCEPTION("Can't place robot: " << unRobots << " robots don't fit in the placement region");
+         }
+         ++unTrials;
+         UInt32 unPick = unTaken + m_pcRNG->Uniform(CRange<UInt32>(0, m_vecPlacementCells.size() - unTaken));
+         std::swap(m_vecPlacementCells[unTaken], m_vecPlacementCells[unPick]);
+         bPlaced = MoveEntity(pcFootBot->GetEmbodiedEntity(),
+                              GetCellPosition(m_vecPlacementCells[unTaken]),
+                              CQuaternion().FromEulerAngles(m_pcRNG->Uniform(CRange<CRadians>(CRadians::ZERO,CRadians::TWO_PI)),
+                              CRadians::ZERO,CRadians::ZERO),false);
+         /* Otherwise a robot not moved yet stands there, the cell stays free for a later draw */
+         if(bPlaced) {
+            ++unTaken;
+         }
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForaging::FindPlacementCells(UInt32 un_robots) {
+   /* The walls and the objects, by their bounding boxes */
+   std::vector<SBoundingBox> vecObstacles;
+   const char* ppchTypes[] = { "box", "cylinder" };
+   CSpace::TMapPerTypePerId& tEntities = GetSpace().GetEntityMapPerType();
+   for(size_t t = 0; t < 2; ++t) {
+      CSpace::TMapPerTypePerId::iterator itType = tEntities.find(ppchTypes[t]);
+      if(itType == tEntities.end()) continue;
+      for(CSpace::TMapPerType::iterator it = itType->second.begin(); it != itType->second.end(); ++it) {
+         CEmbodiedEntity& cBody = (t == 0 ?
+                                   any_cast<CBoxEntity*>(it->second)->GetEmbodiedEntity() :
+                                   any_cast<CCylinderEntity*>(it->second)->GetEmbodiedEntity());
+         vecObstacles.push_back(cBody.GetBoundingBox());
+      }
+   }
+
+   /*
+    * The coarsest grid with twice as many cells as robots, so that the robots spread like a uniform
+    * draw, refined down to cells of one robot until enough cells are free
+    */
+   Real fWidth = PLACEMENT_MAX_X - PLACEMENT_MIN_X;
+   Real fHeight = PLACEMENT_MAX_Y - PLACEMENT_MIN_Y;
+   Real fMinPitch = 2.0f * FOOTBOT_RADIUS + PLACEMENT_CLEARANCE;
+   Real fPitch = Max<Real>(fMinPitch, Sqrt(fWidth * fHeight / (2.0f * Max<UInt32>(un_robots, 1))));
+   while(true) {
+      m_unPlacementColumns = Max<UInt32>(1, static_cast<UInt32>(Floor(fWidth / fPitch)));
+      m_unPlacementRows = Max<UInt32>(1, static_cast<UInt32>(Floor(fHeight / fPitch)));
+      m_cPlacementCellSize.Set(fWidth / m_unPlacementColumns, fHeight / m_unPlacementRows);
+      m_vecPlacementCells.clear();
+      for(UInt32 i = 0; i < m_unPlacementColumns * m_unPlacementRows; ++i) {
+         Real fMinX = PLACEMENT_MIN_X + (i % m_unPlacementColumns) * m_cPlacementCellSize.GetX();
+         Real fMinY = PLACEMENT_MIN_Y + (i / m_unPlacementColumns) * m_cPlacementCellSize.GetY();
+         bool bFree = true;
+         for(size_t j = 0; j < vecObstacles.size() && bFree; ++j) {
+            bFree = vecObstacles[j].MaxCorner.GetX() + PLACEMENT_CLEARANCE < fMinX ||
+                    vecObstacles[j].MinCorner.GetX() - PLACEMENT_CLEARANCE > fMinX + m_cPlacementCellSize.GetX() ||
+                    vecObstacles[j].MaxCorner.GetY() + PLACEMENT_CLEARANCE < fMinY ||
+                    vecObstacles[j].MinCorner.GetY() - PLACEMENT_CLEARANCE > fMinY + m_cPlacementCellSize.GetY();
+         }
+         if(bFree) {
+            m_vecPlacementCells.push_back(i);
+         }
+      }
+      if(m_vecPlacementCells.size() >= un_robots || fPitch == fMinPitch) {
+         return;
+      }
+      fPitch = Max<Real>(fMinPitch, fPitch * 0.9f);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+CVector3 CForaging::GetCellPosition(UInt32 un_cell) {
+   /* The whole body stays inside the cell, robots of different cells never touch. The cells are at least
+      as large as a robot with its clearance */
+   Real fMargin = FOOTBOT_RADIUS + PLACEMENT_CLEARANCE / 2.0f;
+   Real fMinX = PLACEMENT_MIN_X + (un_cell % m_unPlacementColumns) * m_cPlacementCellSize.GetX();
+   Real fMinY = PLACEMENT_MIN_Y + (un_cell / m_unPlacementColumns) * m_cPlacementCellSize.GetY();
+   return CVector3(m_pcRNG->Uniform(CRange<Real>(fMinX + fMargin, fMinX + m_cPlacementCellSize.GetX() - fMargin)),
+                   m_pcRNG->Uniform(CRange<Real>(fMinY + fMargin, fMinY + m_cPlacementCellSize.GetY() - fMargin)),
+                   0);
 }
 
 /****************************************/
 /****************************************/
 
 CVector3 CForaging::GetRandomPosition() {
-  Real temp;
-  Real fPoseX = m_pcRNG->Uniform(CRange<Real>(1.5f, 5.5f));
-  Real fPoseY = m_pcRNG->Uniform(CRange<Real>(-2.0f, 2.0f));
+  Real fPoseX = m_pcRNG->Uniform(CRange<Real>(PLACEMENT_MIN_X, PLACEMENT_MAX_X));
+  Real fPoseY = m_pcRNG->Uniform(CRange<Real>(PLACEMENT_MIN_Y, PLACEMENT_MAX_Y));
 
   return CVector3(fPoseX, fPoseY, 0);
 }
@@ -1,9 +1,31 @@
 #include <argos3/core/simulator/loop_functions.h>
 #include <argos3/plugins/robots/foot-bot/simulator/footbot_entity.h>
+#include <argos3/core/wrappers/lua/lua_controller.h>
+#include "foraging_controller.h"
+#include "sensor_digest.h"
 #include <fstream>
 
 using namespace argos;
 
+/**
+ * State of one object as seen by the loop functions at the last update
+ */
+struct SObject {
+   CEmbodiedEntity* Body;
+   CVector3 Position;
+   bool InArea;
+   bool InCache;
+};
+
+/**
+ * Coloured rectangle of the floor, bounds included
+ */
+struct SFloorArea {
+   Real MinX, MaxX;
+   Real MinY, MaxY;
+   bool Target; // target (construction) area or cache area
+};
+
 class CForaging : public CLoopFunctions {
 
 public:
@@ -47,6 +69,12 @@ public:
     */
    virtual void PostStep();
 
+   /**
+    * Returns true when one of the early-stop rules has fired in PostStep().
+    * The simulator also stops at the length of the experiment.
+    */
+   virtual bool IsExperimentFinished();
+
    /**
     * Performs actions right after an experiment is finalized.
     */
@@ -71,13 +99,92 @@ private:
     */
    void FilterObjects();
 
+   /**
+    * Caches the bodies of the objects and reads their positions.
+    * The objects are neither created nor removed during the experiment.
+    */
+   void TrackObjects();
+
+   /**
+    * Updates the positions of the objects that moved since the last update, and
+    * the number of objects in the construction and cache areas. Returns the number of moved objects.
+    */
+   UInt32 UpdateObjects();
+
+   /**
+    * Caches the bodies and the lua states of the robots, and registers sensor_digest()
+    * in the lua states of the robots that have its sensors
+    */
+   void TrackRobots();
+
+   /**
+    * Reads the parameters of the controllers once for all the robots, and pushes them to the
+    * controllers. They are left empty when the file can't be read, the controllers then read it themselves.
+    */
+   void LoadControllerParameters();
+   void PushControllerParameters();
+
+   /**
+    * Appends one row of metrics for the current step to m_vecMetrics
+    */
+   void SampleMetrics();
+
+   /**
+    * Writes the rows of metrics collected since the last reset into the metrics file
+    */
+   void WriteMetrics();
+
+   /**
+    * Returns the result of the experiment for the chosen objective
+    */
+   Real ComputeObjective();
+
+   /**
+    * Precomputes the region of every cell of the floor raster.
+    * A cell gets the region covering it entirely, or FLOOR_MIXED_REGION when it
+    * crosses a border, in which case the point itself is tested.
+    */
+   void BuildFloor();
+
+   /**
+    * Sets the colour of every region from the current grey levels
+    */
+   void UpdateFloorPalette();
+
+   /**
+    * Returns the region of a point: 0 for the plain floor, i + 1 for m_vecFloorAreas[i]
+    */
+   UInt8 GetFloorRegion(const CVector2& c_position_on_plane);
+
+   /**
+    * Returns true if the given position is inside the construction area
+    */
+   bool IsInConstructionArea(const CVector3& c_position);
+
+   /**
+    * Returns true if the given position is inside the cache area
+    */
+   bool IsInCacheArea(const CVector3& c_position);
+
 
    /*
      * Method used to reallocate the robots.
-     * The position is given by the method GetRandomPosition().
+     * Every robot takes a random free cell of a grid over the placement region, so hundreds of
+     * robots are placed in about one physics check each.
      */
     void MoveRobots();
 
+   /**
+    * Fills m_vecPlacementCells with the cells of the placement grid clear of the walls and
+    * objects, on a grid fine enough to hold the given number of robots when possible
+    */
+   void FindPlacementCells(UInt32 un_robots);
+
+   /**
+    * Returns a random position of a robot inside the given cell of the placement grid
+    */
+   CVector3 GetCellPosition(UInt32 un_cell);
+
    
 private:
 
@@ -96,6 +203,80 @@ private:
 
    Real m_fCacheValue, m_fTargetValue;
 
+   /**
+    * File where the number of objects in the construction area is written
+    */
+   std::string m_strOutputFile;
+
+   /**
+    * Result written in the output file: the objects in the construction area at the end
+    * (objects), the mean number of objects in the area over the experiment (auc), or the
+    * seconds left when m_unTargetObjects objects are in the area, 0 when never (time)
+    */
+   UInt32 m_unObjective;
+   UInt32 m_unTargetObjects;
+   UInt64 m_unDeliveredSum;
+   UInt32 m_unTargetStep;
+
+   /**
+    * Early-stop rule, disabled by default : the experiment is finished as soon as every
+    * object is in the construction area
+    */
+   bool m_bStopWhenDelivered;
+   bool m_bFinished;
+
+   /**
+    * Objects tracked since Init(), and how many of them are in the construction area
+    */
+   std::vector<SObject> m_vecObjects;
+   UInt32 m_unObjectsInArea;
+   UInt32 m_unObjectsInCache;
+
+   /**
+    * Robots tracked since Init(), their lua state is NULL when they don't run a lua controller,
+    * and their native controller NULL when they don't run the foraging_controller
+    */
+   std::vector<CEmbodiedEntity*> m_vecRobotBodies;
+   std::vector<lua_State*> m_vecRobotLuaStates;
+   std::vector<CForagingController*> m_vecRobotControllers;
+   std::vector<CSensorDigest*> m_vecSensorDigests;
+
+   /**
+    * Parameters file of the pso controllers (the environment variable FORAGING_PARAMETERS
+    * overrides it) and its values, read again at every reset
+    */
+   std::string m_strParametersFile;
+   std::vector<Real> m_vecControllerParameters;
+
+   /**
+    * Metrics stream, disabled when the file name is empty: one row every m_unMetricsEvery
+    * steps, kept in memory during the experiment and written once by PostExperiment().
+    * A row is the step, the objects delivered, the objects in the cache area, the robots
+    * touching another body, then the number of robots in each controller state (the
+    * STATE variable of the lua controllers) in the order of m_vecMetricsStates.
+    */
+   std::string m_strMetricsFile;
+   UInt32 m_unMetricsEvery;
+   std::vector<std::string> m_vecMetricsStates;
+   std::vector<UInt32> m_vecMetrics;
+
+   /**
+    * Floor areas by priority (the first one containing a point gives its colour),
+    * raster of their regions over the arena and colour of each region
+    */
+   std::vector<SFloorArea> m_vecFloorAreas;
+   std::vector<UInt8> m_vecFloorRegions;
+   std::vector<CColor> m_vecFloorPalette;
+   CVector2 m_cFloorOrigin;
+   UInt32 m_unFloorColumns, m_unFloorRows;
+
+   /**
+    * Grid the robots are placed on, and its cells clear of the walls and objects
+    */
+   UInt32 m_unPlacementColumns, m_unPlacementRows;
+   CVector2 m_cPlacementCellSize;
+   std::vector<UInt32> m_vecPlacementCells;
+
    CRandom::CRNG* m_pcRNG;
    CRange<Real> m_cLightGrayRange; 
    CRange<Real> m_cDarkGrayRange;
@@ -0,0 +1,881 @@
+#include "foraging_controller.h"
+
+#include <argos3/core/utility/logging/argos_log.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/****************************************/
+/****************************************/
+
+/* The constants of the lua script, PI included, so that both controllers compute the same speeds */
+static const Real PI_LUA                   = 3.14159265359;
+static const Real SPEED_REVERSE            = 200;
+static const Real SLOWDOWN_TURN_CARRYING   = 0.7;
+static const Real SLOWDOWN_WALKING_IN_CACHE = 0.2;
+static const Real SLOWDOWN_HUNTING         = 0.4;
+static const Real SLOWDOWN_IN_NEST         = 0.5;
+static const Real LIGHT_VALUE_DROP         = 0.95;
+static const Real NOT_SENSED_DISTANCE      = 1000000;
+static const Real TOUCH_DISTANCE           = 19;
+static const Real TOUCH_ANGLE              = 0.3;
+static const UInt32 LED_INDEX              = 12; // led 13 of the lua script
+
+static const SInt32 UNLOADING_BACKWARDS    = 1;
+static const SInt32 UNLOADING_TURN         = 1 + 30;
+static const SInt32 UNLOADING_DROP         = 1 + 30 + 1;
+
+/* Colours of the leds, compared on their red, green and blue channels like the strings of the lua script */
+static const CColor COLOR_HUNTER(255, 255, 255, 0);
+static const CColor COLOR_NESTER(0, 255, 0, 0);
+static const CColor COLOR_DO_NOT_DISTURB(0, 255, 255, 0);
+static const CColor COLOR_OBJECT(255, 0, 0, 0);
+
+static bool SameColor(const CColor& c_color1, const CColor& c_color2) {
+   return c_color1.GetRed() == c_color2.GetRed() &&
+          c_color1.GetGreen() == c_color2.GetGreen() &&
+          c_color1.GetBlue() == c_color2.GetBlue();
+}
+
+static bool IsRobot(const CColor& c_color) {
+   return SameColor(c_color, COLOR_HUNTER) || SameColor(c_color, COLOR_NESTER);
+}
+
+/* Angle of the proximity and light sensor i (from 1 to 24), as to_radian() of the lua script */
+static Real ToRadian(UInt32 un_index) {
+   Real fIndex = un_index;
+   if(fIndex <= 12) {
+      return (fIndex / 12.5) * PI_LUA;
+   }
+   return (-((25 - fIndex) / 12.5)) * PI_LUA;
+}
+
+/****************************************/
+/****************************************/
+
+CForagingController::CForagingController() :
+   m_pcWheels(NULL),
+   m_pcLEDs(NULL),
+   m_pcGripper(NULL),
+   m_pcTurret(NULL),
+   m_pcCamera(NULL),
+   m_pcTurretEncoder(NULL),
+   m_pcProximity(NULL),
+   m_pcLight(NULL),
+   m_pcGround(NULL) {
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::Init(TConfigurationNode& t_node) {
+   m_pcWheels        = GetActuator<CCI_DifferentialSteeringActuator          >("differential_steering");
+   m_pcLEDs          = GetActuator<CCI_LEDsActuator                          >("leds");
+   m_pcGripper       = GetActuator<CCI_FootBotGripperActuator                >("footbot_gripper");
+   m_pcTurret        = GetActuator<CCI_FootBotTurretActuator                 >("footbot_turret");
+   m_pcCamera        = GetSensor  <CCI_ColoredBlobOmnidirectionalCameraSensor>("colored_blob_omnidirectional_camera");
+   m_pcTurretEncoder = GetSensor  <CCI_FootBotTurretEncoderSensor            >("footbot_turret_encoder");
+   m_pcProximity     = GetSensor  <CCI_FootBotProximitySensor                >("footbot_proximity");
+   m_pcLight         = GetSensor  <CCI_FootBotLightSensor                    >("footbot_light");
+   m_pcGround        = GetSensor  <CCI_FootBotMotorGroundSensor              >("footbot_motor_ground");
+   Reset();
+}
+
+/****************************************/
+/****************************************/
+
+/* init_variables() of the lua script: the parameters are loaded again at the first step, the pushed ones are kept */
+void CForagingController::Reset() {
+   m_eState = STATE_READY;
+   m_eJob = JOB_NESTER; // the robot first thinks it is a nester, it becomes a hunter if it sees an object
+
+   m_bCacheKnown = m_bNestKnown = m_bTempKnown = false;
+   m_fFloorCache = m_fFloorNest = m_fFloorTemp = 0;
+
+   SPerception sNothing = {false, 0, 0};
+   m_sObstacle = m_sRobot = m_sOccupiedRobot = m_sObject = sNothing;
+
+   m_bLightSensed = false;
+   m_fLightAngle = 0;
+   m_fLightValue = 0;
+
+   m_bGreySensed = false;
+   for(UInt32 i = 0; i < 4; ++i) {
+      m_bGreyAngles[i] = false;
+   }
+   m_fGreyValue = 0;
+
+   m_bTouchingObjectWithGripper = false;
+   m_bGrabingObject = false;
+
+   m_nGrabing = 0;
+   m_nWalkAway = 0;
+   m_nGlobal = 0;
+   m_nSteppingInCache = 0;
+   m_nLeavingCache = 0;
+   m_nUnloading = 0;
+   m_nReachObject = 0;
+   m_nFinishing = 0;
+}
+
+/****************************************/
+/****************************************/
+
+const char* CForagingController::GetStateName() const {
+   switch(m_eState) {
+      case STATE_READY:                return "READY";
+      case STATE_EXPLORING:            return "EXPLORING";
+      case STATE_GRABING:              return "GRABING";
+      case STATE_WALK_AWAY:            return "WALK_AWAY";
+      case STATE_WAIT:                 return "WAIT";
+      case STATE_CACHING_NESTING:      return "CACHING_NESTING";
+      case STATE_CACHING_NESTING_BACK: return "CACHING_NESTING_BACK";
+      case STATE_GRABING_NESTING:      return "GRABING_NESTING";
+      case STATE_WALK_AWAY_NESTING:    return "WALK_AWAY_NESTING";
+      case STATE_UNLOADING:            return "UNLOADING";
+      case STATE_FINISHING:            return "FINISHING";
+   }
+   return "UNKNOWN";
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::SetParameters(const std::vector<Real>& vec_values) {
+   m_vecPushedParameters = vec_values;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::LoadParameters() {
+   std::vector<Real> vecValues = m_vecPushedParameters;
+   if(vecValues.empty()) {
+      std::string strFile = "input/parameters.csv";
+      const char* pchFile = ::getenv("FORAGING_PARAMETERS");
+      if(pchFile != NULL) {
+         strFile = pchFile;
+      }
+      LOG << "[INFO] Loading parameters from " << strFile << std::endl;
+
+      std::ifstream cStream(strFile.c_str());
+      std::string strLine;
+      while(std::getline(cStream, strLine) && vecValues.size() < 8) {
+         vecValues.push_back(::atof(strLine.c_str()));
+      }
+      if(vecValues.size() < 8) {
+         THROW_ARGOSEXCEPTION("Can't read the 8 parameters of the controller in " << strFile);
+      }
+   }
+
+   m_sParams.Speed               = Floor(vecValues[0]);
+   m_sParams.SpeedWalkAway       = Floor(vecValues[1]);
+   m_sParams.LightValueFinishing = vecValues[2];
+   m_sParams.DistanceAvoidRobot  = vecValues[3];
+   m_sParams.ReachLight          = vecValues[4];
+   m_sParams.StartJob            = static_cast<SInt32>(Floor(vecValues[5]));
+   m_sParams.ToFinishing         = static_cast<SInt32>(Floor(vecValues[6]));
+   m_sParams.ToWaiter            = static_cast<SInt32>(Floor(vecValues[7]));
+
+   m_nGrabingMaxForHunter = static_cast<SInt32>(Floor(5000 / m_sParams.Speed));
+   m_nGrabingMaxForNester = static_cast<SInt32>(Floor(10000 / m_sParams.Speed));
+   m_nWalkAwayMax         = static_cast<SInt32>(Floor(3600 / m_sParams.SpeedWalkAway));
+   m_nSteppingInCacheMax  = static_cast<SInt32>(Floor(225 / (m_sParams.Speed * SLOWDOWN_WALKING_IN_CACHE)));
+   m_nLeavingCacheMax     = static_cast<SInt32>(Floor(600 / (m_sParams.Speed * SLOWDOWN_WALKING_IN_CACHE)));
+   m_nUnloadingAdvance    = 1 + 30 + static_cast<SInt32>(Floor(500 / m_sParams.Speed));
+   m_nReachObjectMax      = static_cast<SInt32>(Floor(3000 / m_sParams.Speed));
+
+   m_fDistanceAvoidRobotClose  = m_sParams.DistanceAvoidRobot / 3;
+   m_fDistanceAvoidRobotMedium = m_sParams.DistanceAvoidRobot / 2;
+   m_fDistanceAvoidRobotHigh   = m_sParams.DistanceAvoidRobot * 2;
+}
+
+/****************************************/
+/****************************************/
+
+bool CForagingController::NeedGroundColor() const {
+   return !(m_eState == STATE_CACHING_NESTING || m_eState == STATE_CACHING_NESTING_BACK || m_eState == STATE_UNLOADING);
+}
+
+bool CForagingController::NeedClosestObstacle() const {
+   return m_eState == STATE_READY || m_eState == STATE_EXPLORING || m_eState == STATE_WALK_AWAY ||
+          m_eState == STATE_WAIT || m_eState == STATE_WALK_AWAY_NESTING || m_nGlobal < m_sParams.ReachLight;
+}
+
+bool CForagingController::NeedClosestRobot() const {
+   return !(m_eState == STATE_CACHING_NESTING || m_eState == STATE_CACHING_NESTING_BACK || m_eState == STATE_GRABING_NESTING ||
+            m_eState == STATE_UNLOADING || m_eState == STATE_FINISHING);
+}
+
+bool CForagingController::NeedClosestOccupiedRobot() const {
+   return m_eState == STATE_EXPLORING || m_eState == STATE_WAIT;
+}
+
+bool CForagingController::NeedClosestObject() const {
+   return m_eState == STATE_EXPLORING || m_eState == STATE_WALK_AWAY || (m_eJob == JOB_NESTER && m_eState == STATE_READY) ||
+          m_eState == STATE_WAIT || m_eState == STATE_CACHING_NESTING;
+}
+
+bool CForagingController::NeedLight() const {
+   return m_eState == STATE_GRABING || m_eState == STATE_WALK_AWAY || m_eState == STATE_WAIT ||
+          m_eState == STATE_WALK_AWAY_NESTING || m_eState == STATE_FINISHING || m_nGlobal < m_sParams.ReachLight;
+}
+
+bool CForagingController::NeedTouchingObject() const {
+   return m_eState == STATE_EXPLORING || m_eState == STATE_WAIT || m_eState == STATE_CACHING_NESTING;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::CheckGroundColor() {
+   m_bGreySensed = false;
+   m_fGreyValue = 0;
+   const CCI_FootBotMotorGroundSensor::TReadings& tReadings = m_pcGround->GetReadings();
+   for(UInt32 i = 0; i < 4; ++i) {
+      m_bGreyAngles[i] = false;
+      if(tReadings[i].Value < 1) {
+         m_bGreySensed = true;
+         m_fGreyValue = tReadings[i].Value;
+         m_bGreyAngles[i] = true;
+      }
+   }
+}
+
+void CForagingController::CheckClosestObstacle() {
+   m_sObstacle.Sensed = false;
+   m_sObstacle.Angle = 0;
+   m_sObstacle.Distance = 0;
+   const CCI_FootBotProximitySensor::TReadings& tReadings = m_pcProximity->GetReadings();
+   for(UInt32 i = 0; i < 24; ++i) {
+      if(tReadings[i].Value > m_sObstacle.Distance) {
+         m_sObstacle.Distance = tReadings[i].Value;
+         m_sObstacle.Sensed = true;
+         m_sObstacle.Angle = ToRadian(i + 1);
+      }
+   }
+}
+
+void CForagingController::CheckClosestRobot() {
+   m_sRobot.Sensed = false;
+   m_sRobot.Angle = 0;
+   m_sRobot.Distance = NOT_SENSED_DISTANCE;
+   const CCI_ColoredBlobOmnidirectionalCameraSensor::TBlobList& tBlobs = m_pcCamera->GetReadings().BlobList;
+   for(size_t i = 0; i < tBlobs.size(); ++i) {
+      if(IsRobot(tBlobs[i]->Color) && tBlobs[i]->Distance < m_sRobot.Distance) {
+         m_sRobot.Distance = tBlobs[i]->Distance;
+         m_sRobot.Sensed = true;
+         m_sRobot.Angle = tBlobs[i]->Angle.GetValue();
+      }
+   }
+}
+
+void CForagingController::CheckClosestOccupiedRobot() {
+   m_sOccupiedRobot.Sensed = false;
+   m_sOccupiedRobot.Angle = 0;
+   m_sOccupiedRobot.Distance = NOT_SENSED_DISTANCE;
+   const CCI_ColoredBlobOmnidirectionalCameraSensor::TBlobList& tBlobs = m_pcCamera->GetReadings().BlobList;
+   for(size_t i = 0; i < tBlobs.size(); ++i) {
+      if(SameColor(tBlobs[i]->Color, COLOR_DO_NOT_DISTURB) && tBlobs[i]->Distance < m_sOccupiedRobot.Distance) {
+         m_sOccupiedRobot.Sensed = true;
+         m_sOccupiedRobot.Angle = tBlobs[i]->Angle.GetValue();
+         m_sOccupiedRobot.Distance = tBlobs[i]->Distance;
+      }
+   }
+}
+
+void CForagingController::CheckClosestObject() {
+   m_sObject.Sensed = false;
+   m_sObject.Angle = 0;
+   m_sObject.Distance = NOT_SENSED_DISTANCE;
+   const CCI_ColoredBlobOmnidirectionalCameraSensor::TBlobList& tBlobs = m_pcCamera->GetReadings().BlobList;
+   for(size_t i = 0; i < tBlobs.size(); ++i) {
+      if(SameColor(tBlobs[i]->Color, COLOR_OBJECT) && tBlobs[i]->Distance < m_sObject.Distance) {
+         m_sObject.Sensed = true;
+         m_sObject.Angle = tBlobs[i]->Angle.GetValue();
+         m_sObject.Distance = tBlobs[i]->Distance;
+      }
+   }
+}
+
+void CForagingController::CheckTouchObjectWithGripper() {
+   Real fMinDistance = NOT_SENSED_DISTANCE;
+   Real fTurretRotation = m_pcTurretEncoder->GetRotation().GetValue();
+   const CCI_ColoredBlobOmnidirectionalCameraSensor::TBlobList& tBlobs = m_pcCamera->GetReadings().BlobList;
+   for(size_t i = 0; i < tBlobs.size(); ++i) {
+      if(SameColor(tBlobs[i]->Color, COLOR_OBJECT) &&
+         Abs(tBlobs[i]->Angle.GetValue() - fTurretRotation) < TOUCH_ANGLE &&
+         tBlobs[i]->Distance < fMinDistance) {
+         fMinDistance = tBlobs[i]->Distance;
+      }
+   }
+   m_bTouchingObjectWithGripper = (fMinDistance < TOUCH_DISTANCE);
+}
+
+void CForagingController::CheckLight() {
+   m_bLightSensed = false;
+   m_fLightAngle = 0;
+   m_fLightValue = 0;
+   const CCI_FootBotLightSensor::TReadings& tReadings = m_pcLight->GetReadings();
+   for(UInt32 i = 0; i < 24; ++i) {
+      if(tReadings[i].Value > m_fLightValue) {
+         m_fLightValue = tReadings[i].Value;
+         m_bLightSensed = true;
+         m_fLightAngle = ToRadian(i + 1);
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+/* As start_job() of the lua script, the job given by the caller is ignored */
+void CForagingController::StartJob() {
+   if(m_eJob == JOB_HUNTER) {
+      SwitchState(STATE_EXPLORING);
+   }
+   else {
+      SwitchState(STATE_WAIT);
+   }
+}
+
+void CForagingController::SwitchJobHunter() {
+   m_eJob = JOB_HUNTER;
+   m_eState = STATE_READY;
+   SetVelocity(0, 0);
+}
+
+void CForagingController::SwitchJobNester() {
+   m_eJob = JOB_NESTER;
+   m_eState = STATE_READY;
+   SetVelocity(0, 0);
+}
+
+/* The counters reset by each switch_state_*() of the lua script */
+void CForagingController::SwitchState(EState e_state) {
+   m_eState = e_state;
+   switch(e_state) {
+      case STATE_GRABING:              m_nGrabing = 0; break;
+      case STATE_WALK_AWAY:            m_nWalkAway = 0; break;
+      case STATE_WAIT:                 m_nFinishing = 0; break;
+      case STATE_GRABING_NESTING:      m_nGrabing = 0; m_nFinishing = 0; break;
+      case STATE_CACHING_NESTING:      m_nSteppingInCache = 0; break;
+      case STATE_CACHING_NESTING_BACK: m_nLeavingCache = 0; break;
+      case STATE_UNLOADING:            m_nUnloading = 0; break;
+      case STATE_WALK_AWAY_NESTING:    m_nWalkAway = 0; break;
+      case STATE_FINISHING:            m_nFinishing = 0; break;
+      default:                         break;
+   }
+   SetVelocity(0, 0);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::SetVelocity(Real f_left, Real f_right) {
+   m_pcWheels->SetLinearVelocity(f_left, f_right);
+}
+
+/* The expressions keep the order of the operations of the lua script, for the same rounding */
+void CForagingController::Avoid(Real f_angle, Real f_slowdown) {
+   Real fSlowdownNearCache = 1;
+   if(m_bLightSensed && m_fLightValue > LIGHT_VALUE_DROP) {
+      fSlowdownNearCache = 0.5;
+   }
+   Real fSpeed = m_sParams.Speed * f_slowdown * fSlowdownNearCache;
+
+   if(f_angle == 0) { // the obstacle is in front of the robot, almost complete 180
+      SetVelocity(SPEED_REVERSE, -SPEED_REVERSE);
+   }
+   else if(f_angle >= 0) { // the thing to avoid comes from the left
+      if(f_angle <= (PI_LUA / 2)) {
+         SetVelocity(fSpeed, -fSpeed * f_angle / PI_LUA);
+      }
+      else {
+         SetVelocity(fSpeed, fSpeed * (PI_LUA - f_angle) / PI_LUA);
+      }
+   }
+   else {
+      if(f_angle >= (-PI_LUA / 2)) {
+         SetVelocity(fSpeed * (-f_angle) / PI_LUA, fSpeed);
+      }
+      else {
+         SetVelocity(fSpeed * (PI_LUA + f_angle) / PI_LUA, fSpeed);
+      }
+   }
+}
+
+/* Turns away from the grey area, according to the ground sensors in it */
+void CForagingController::AvoidGrey() {
+   const bool* g = m_bGreyAngles;
+   if(g[0] && g[1] && g[2] && g[3]) { // middle of grey spot
+      if(m_sObstacle.Sensed) Avoid(m_sObstacle.Angle);
+      else WalkForward();
+   }
+   else if(g[0] && g[1] && g[2]) Avoid(3 * PI_LUA / 4);
+   else if(g[1] && g[2] && g[3]) Avoid(-3 * PI_LUA / 4);
+   else if(g[2] && g[3] && g[0]) Avoid(-PI_LUA / 4);
+   else if(g[3] && g[0] && g[1]) Avoid(PI_LUA / 4);
+   else if(g[0] && g[1]) Avoid(-PI_LUA / 2);
+   else if(g[1] && g[2]) WalkForward();
+   else if(g[2] && g[3]) Avoid(PI_LUA / 2);
+   else if(g[3] && g[0]) Avoid(0);
+   else if(g[0]) Avoid(PI_LUA / 4);
+   else if(g[1]) Avoid(3 * PI_LUA / 4);
+   else if(g[2]) Avoid(-3 * PI_LUA / 4);
+   else if(g[3]) Avoid(-PI_LUA / 4);
+   else {
+      if(m_sObstacle.Sensed) Avoid(m_sObstacle.Angle);
+      else WalkForward();
+   }
+}
+
+void CForagingController::Reach(Real f_angle, Real f_slowdown) {
+   Real fSpeed = m_sParams.Speed * f_slowdown;
+   /* To turn quickly when |angle| > PI/2, one wheel goes backwards */
+   if(f_angle >= 0) {
+      SetVelocity((PI_LUA - 2 * f_angle) * fSpeed / PI_LUA, fSpeed);
+   }
+   else {
+      SetVelocity(fSpeed, (PI_LUA + 2 * f_angle) * fSpeed / PI_LUA);
+   }
+}
+
+void CForagingController::ReachWithGripper(Real f_angle) {
+   m_pcTurret->SetPositionControlMode();
+   m_pcTurret->SetRotation(CRadians(f_angle));
+}
+
+void CForagingController::WalkForward() {
+   if(m_eState == STATE_WALK_AWAY || m_eState == STATE_WALK_AWAY_NESTING) {
+      SetVelocity(m_sParams.SpeedWalkAway, m_sParams.SpeedWalkAway);
+   }
+   else {
+      SetVelocity(m_sParams.Speed, m_sParams.Speed);
+   }
+}
+
+void CForagingController::WalkBackwards(Real f_slowdown) {
+   SetVelocity(-m_sParams.Speed * f_slowdown, -m_sParams.Speed * f_slowdown);
+}
+
+void CForagingController::GrabObject() {
+   if(!m_bGrabingObject && m_bTouchingObjectWithGripper) {
+      SetVelocity(0, 0);
+      m_pcGripper->LockNegative();
+      m_bGrabingObject = true;
+      m_nGrabing = 0;
+   }
+}
+
+void CForagingController::DropObject() {
+   SetVelocity(0, 0);
+   m_pcGripper->Unlock();
+   m_bGrabingObject = false;
+   m_nGrabing = 0;
+}
+
+/****************************************/
+/****************************************/
+
+/* script_1() and step() of the lua script */
+void CForagingController::ControlStep() {
+   if(m_nGlobal == 0) {
+      LoadParameters();
+   }
+
+   m_pcCamera->Enable();
+   m_pcTurret->SetPassiveMode();
+
+   /* Both jobs show the hunter colour, as in the lua script */
+   m_pcLEDs->SetSingleColor(LED_INDEX, COLOR_HUNTER);
+   if(m_eState == STATE_GRABING || m_eState == STATE_GRABING_NESTING || m_eState == STATE_CACHING_NESTING ||
+      m_eState == STATE_CACHING_NESTING_BACK || m_eState == STATE_UNLOADING) {
+      m_pcLEDs->SetSingleColor(LED_INDEX, COLOR_DO_NOT_DISTURB);
+   }
+
+   /* Only the sensors needed in the current state are read, the others keep their last values */
+   if(NeedGroundColor())          CheckGroundColor();
+   if(NeedClosestObstacle())      CheckClosestObstacle();
+   if(NeedClosestRobot())         CheckClosestRobot();
+   if(NeedClosestOccupiedRobot()) CheckClosestOccupiedRobot();
+   if(NeedClosestObject())        CheckClosestObject();
+   if(NeedLight())                CheckLight();
+   if(NeedTouchingObject())       CheckTouchObjectWithGripper();
+
+   ++m_nGlobal;
+
+   if(m_nGlobal < m_sParams.ReachLight) { // first reach the light, so that no robot stays stuck behind the nest
+      if(m_sObstacle.Sensed) {
+         Avoid(m_sObstacle.Angle);
+      }
+      else if(m_bLightSensed) {
+         Reach(m_fLightAngle);
+      }
+      else {
+         WalkForward();
+      }
+   }
+   else if(m_nGlobal == m_sParams.StartJob) {
+      StartJob();
+   }
+   else if(m_eJob == JOB_HUNTER) {
+      HunterStep();
+   }
+   else {
+      NesterStep();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::HunterStep() {
+   /* A hunter seeing a second grey level is a nester */
+   if(m_eState != STATE_READY && m_bGreySensed && !m_bCacheKnown && m_bTempKnown) {
+      if(m_fFloorTemp > m_fGreyValue) {
+         m_fFloorNest = m_fGreyValue;
+         m_fFloorCache = m_fFloorTemp;
+         m_bNestKnown = m_bCacheKnown = true;
+         StartJob();
+      }
+      else if(m_fFloorTemp < m_fGreyValue) {
+         m_fFloorCache = m_fGreyValue;
+         m_fFloorNest = m_fFloorTemp;
+         m_bNestKnown = m_bCacheKnown = true;
+         StartJob();
+      }
+   }
+
+   switch(m_eState) {
+      /* The job hasn't started yet: simple obstacle and robot avoidance */
+      case STATE_READY:
+         if(m_nGlobal >= m_sParams.StartJob) {
+            StartJob();
+         }
+         else if(m_bGreySensed) {
+            AvoidGrey();
+         }
+         else if(m_sObstacle.Sensed) {
+            Avoid(m_sObstacle.Angle);
+         }
+         else if(m_sRobot.Sensed && m_sRobot.Distance < m_fDistanceAvoidRobotClose) {
+            Avoid(m_sRobot.Angle);
+         }
+         else {
+            WalkForward();
+         }
+         break;
+
+      /* Explores the arena, goes towards the objects and grabs them */
+      case STATE_EXPLORING:
+         if(m_bGreySensed) {
+            AvoidGrey();
+         }
+         else if(!m_sObject.Sensed) {
+            if(m_sObstacle.Sensed) {
+               Avoid(m_sObstacle.Angle);
+            }
+            else if(m_sRobot.Sensed && m_sRobot.Distance < m_sParams.DistanceAvoidRobot) {
+               Avoid(m_sRobot.Angle);
+            }
+            else {
+               WalkForward();
+            }
+         }
+         else if(!m_bTouchingObjectWithGripper) {
+            if(m_sOccupiedRobot.Sensed && m_sOccupiedRobot.Distance < m_fDistanceAvoidRobotHigh) {
+               Avoid(m_sOccupiedRobot.Angle);
+            }
+            else if(m_sRobot.Sensed && m_sRobot.Distance < m_sObject.Distance) {
+               Avoid(m_sRobot.Angle);
+            }
+            else {
+               Reach(m_sObject.Angle, SLOWDOWN_HUNTING);
+               ReachWithGripper(m_sObject.Angle);
+            }
+         }
+         else {
+            GrabObject();
+            SwitchState(STATE_GRABING);
+         }
+         break;
+
+      /* Brings the object to the middle of the arena, where the light is */
+      case STATE_GRABING:
+         ++m_nGrabing;
+         ReachWithGripper(0);
+         if(m_bGreySensed || m_nGrabing > m_nGrabingMaxForHunter) {
+            DropObject();
+            SwitchState(STATE_WALK_AWAY);
+         }
+         else if(m_sRobot.Sensed && m_sRobot.Distance < m_fDistanceAvoidRobotMedium) {
+            Avoid(m_sRobot.Angle, SLOWDOWN_TURN_CARRYING);
+         }
+         else if(m_bLightSensed) {
+            Reach(m_fLightAngle, SLOWDOWN_TURN_CARRYING);
+         }
+         else {
+            WalkForward();
+         }
+         break;
+
+      /* Walks away from the object it just dropped */
+      case STATE_WALK_AWAY:
+         ++m_nWalkAway;
+         if(m_bGreySensed) {
+            AvoidGrey();
+         }
+         else if(m_nWalkAway < m_nWalkAwayMax) {
+            if(m_sObstacle.Sensed) {
+               Avoid(m_sObstacle.Angle);
+            }
+            else if(m_sRobot.Sensed && m_sRobot.Distance < m_sParams.DistanceAvoidRobot) {
+               Avoid(m_sRobot.Angle);
+            }
+            else if(m_bLightSensed) {
+               Avoid(m_fLightAngle);
+            }
+            else {
+               WalkForward();
+            }
+         }
+         else {
+            SwitchState(STATE_EXPLORING);
+         }
+         break;
+
+      default:
+         break;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingController::NesterStep() {
+   switch(m_eState) {
+      /* Every robot starts here: basic obstacle and robot avoidance walk */
+      case STATE_READY:
+         ReachWithGripper(0);
+         if(m_nGlobal >= m_sParams.StartJob) {
+            StartJob();
+         }
+         else if(m_bGreySensed) {
+            /* The first grey level seen can't be told apart, the second one tells which is the cache */
+            if(!m_bTempKnown) {
+               m_fFloorTemp = m_fGreyValue;
+               m_bTempKnown = true;
+            }
+            else if(m_fFloorTemp > m_fGreyValue) {
+               m_fFloorNest = m_fGreyValue;
+               m_fFloorCache = m_fFloorTemp;
+               m_bNestKnown = m_bCacheKnown = true;
+            }
+            else if(m_fFloorTemp < m_fGreyValue) {
+               m_fFloorCache = m_fGreyValue;
+               m_fFloorNest = m_fFloorTemp;
+               m_bNestKnown = m_bCacheKnown = true;
+            }
+            AvoidGrey();
+         }
+         else if(!m_sObject.Sensed) {
+            if(m_sObstacle.Sensed) {
+               Avoid(m_sObstacle.Angle);
+            }
+            else if(m_sRobot.Sensed && m_sRobot.Distance < m_fDistanceAvoidRobotClose) {
+               Avoid(m_sRobot.Angle);
+            }
+            else {
+               WalkForward();
+            }
+         }
+         else {
+            SwitchJobHunter();
+         }
+         break;
+
+      /* Waits for objects to appear in the cache */
+      case STATE_WAIT:
+         ++m_nFinishing;
+         ReachWithGripper(0);
+         if(m_nFinishing > m_sParams.ToFinishing) {
+            SwitchState(STATE_FINISHING);
+         }
+         else if(m_bGreySensed) {
+            if(m_bNestKnown && m_fGreyValue == m_fFloorNest) {
+               if(m_sObstacle.Sensed) {
+                  Avoid(m_sObstacle.Angle, SLOWDOWN_IN_NEST);
+               }
+               else if(m_bLightSensed) {
+                  Reach(m_fLightAngle);
+               }
+               else {
+                  WalkForward();
+               }
+            }
+            else if(!m_sObject.Sensed || !m_bCacheKnown) { // avoid the empty cache
+               AvoidGrey();
+            }
+            else { // step in the cache, there is an object in it
+               SwitchState(STATE_CACHING_NESTING);
+            }
+         }
+         else if(!m_sObject.Sensed) {
+            if(m_sObstacle.Sensed) {
+               Avoid(m_sObstacle.Angle);
+            }
+            else if(m_sOccupiedRobot.Sensed && m_sOccupiedRobot.Distance < m_fDistanceAvoidRobotHigh) {
+               Avoid(m_sOccupiedRobot.Angle);
+            }
+            else if(m_sRobot.Sensed && m_sRobot.Distance < m_sParams.DistanceAvoidRobot) {
+               Avoid(m_sRobot.Angle);
+            }
+            else if(m_bLightSensed) {
+               Reach(m_fLightAngle);
+            }
+            else {
+               WalkForward();
+            }
+         }
+         else if(!m_bTouchingObjectWithGripper) {
+            ++m_nReachObject;
+            if(m_nReachObject < m_nReachObjectMax) {
+               if(m_sOccupiedRobot.Sensed && m_sOccupiedRobot.Distance < m_fDistanceAvoidRobotMedium) {
+                  Avoid(m_sOccupiedRobot.Angle, SLOWDOWN_HUNTING);
+               }
+               else if(m_sRobot.Sensed && m_sRobot.Distance < m_sObject.Distance) {
+                  Avoid(m_sRobot.Angle, SLOWDOWN_HUNTING);
+               }
+               else {
+                  Reach(m_sObject.Angle, SLOWDOWN_HUNTING);
+                  ReachWithGripper(m_sObject.Angle);
+               }
+            }
+            else {
+               m_nReachObject = 0;
+               SwitchState(STATE_WALK_AWAY_NESTING);
+            }
+         }
+         else {
+            GrabObject();
+            SwitchState(STATE_GRABING_NESTING);
+         }
+         break;
+
+      /* Steps into the cache to reach the object, grabs it if it can */
+      case STATE_CACHING_NESTING:
+         ++m_nSteppingInCache;
+         if(m_nSteppingInCache > m_nSteppingInCacheMax) {
+            SwitchState(STATE_CACHING_NESTING_BACK);
+         }
+         else if(!m_bTouchingObjectWithGripper) {
+            Reach(m_sObject.Angle, SLOWDOWN_WALKING_IN_CACHE);
+            ReachWithGripper(m_sObject.Angle);
+         }
+         else {
+            GrabObject();
+            SwitchState(STATE_CACHING_NESTING_BACK);
+         }
+         break;
+
+      /* Leaves the cache backwards, with or without an object */
+      case STATE_CACHING_NESTING_BACK:
+         ++m_nLeavingCache;
+         if(m_nLeavingCache > m_nLeavingCacheMax) {
+            SwitchState(m_bGrabingObject ? STATE_GRABING_NESTING : STATE_WAIT);
+         }
+         else {
+            WalkBackwards(SLOWDOWN_WALKING_IN_CACHE);
+         }
+         break;
+
+      /* Brings the object to the nest */
+      case STATE_GRABING_NESTING:
+         ++m_nGrabing;
+         if(m_bGreySensed) {
+            SwitchState(STATE_UNLOADING);
+         }
+         else if(m_nGrabing > m_nGrabingMaxForNester) { // the nest won't be found anyway
+            DropObject();
+            SwitchState(STATE_WALK_AWAY_NESTING);
+         }
+         else {
+            WalkBackwards();
+         }
+         break;
+
+      /* Unloads the object in the nest: backwards, turret around, drop, forward */
+      case STATE_UNLOADING:
+         ++m_nUnloading;
+         if(m_nUnloading <= UNLOADING_BACKWARDS) {
+            WalkBackwards();
+         }
+         else if(m_nUnloading <= UNLOADING_TURN) {
+            SetVelocity(0, 0);
+            ReachWithGripper(PI_LUA);
+         }
+         else if(m_nUnloading <= UNLOADING_DROP) {
+            DropObject();
+         }
+         else if(m_nUnloading <= m_nUnloadingAdvance) {
+            WalkForward();
+         }
+         else {
+            SwitchState(STATE_WALK_AWAY_NESTING);
+         }
+         break;
+
+      /* Walks away from an object for a while */
+      case STATE_WALK_AWAY_NESTING:
+         ReachWithGripper(0);
+         ++m_nWalkAway;
+         if(m_nWalkAway >= m_nWalkAwayMax) {
+            SwitchState(STATE_WAIT);
+         }
+         else if(m_bGreySensed) {
+            AvoidGrey();
+         }
+         else if(m_sObstacle.Sensed) {
+            Avoid(m_sObstacle.Angle);
+         }
+         else if(m_sRobot.Sensed && m_sRobot.Distance < m_sParams.DistanceAvoidRobot) {
+            Avoid(m_sRobot.Angle);
+         }
+         else if(m_bLightSensed) {
+            Reach(m_fLightAngle);
+         }
+         else {
+            WalkForward();
+         }
+         break;
+
+      /* Has waited for nothing, walks around the nest looking for objects to push in it */
+      case STATE_FINISHING:
+         ++m_nFinishing;
+         if(m_nFinishing > m_sParams.ToWaiter) {
+            SwitchState(STATE_WAIT);
+         }
+         else if(m_bGreySensed) {
+            AvoidGrey();
+         }
+         else if(m_bLightSensed && m_fLightValue > m_sParams.LightValueFinishing) {
+            Avoid(m_fLightAngle);
+         }
+         else {
+            WalkForward();
+         }
+         break;
+
+      default:
+         break;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+REGISTER_CONTROLLER(CForagingController, "foraging_controller")
@@ -0,0 +1,193 @@
+#ifndef FORAGING_CONTROLLER_H
+#define FORAGING_CONTROLLER_H
+
+#include <argos3/core/control_interface/ci_controller.h>
+#include <argos3/plugins/robots/generic/control_interface/ci_differential_steering_actuator.h>
+#include <argos3/plugins/robots/generic/control_interface/ci_leds_actuator.h>
+#include <argos3/plugins/robots/generic/control_interface/ci_colored_blob_omnidirectional_camera_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_gripper_actuator.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_turret_actuator.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_turret_encoder_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_proximity_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_light_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_motor_ground_sensor.h>
+#include <vector>
+
+using namespace argos;
+
+/**
+ * Compiled version of lua_scripts/pso_solution.lua: the same hunter and nester jobs, the same
+ * states and the same 8 parameters, step for step. The lua script stays the reference, every
+ * change of its behaviour must be made here too.
+ */
+class CForagingController : public CCI_Controller {
+
+public:
+
+   enum EJob {
+      JOB_HUNTER,
+      JOB_NESTER
+   };
+
+   enum EState {
+      STATE_READY,                // ready to start the job
+      STATE_EXPLORING,            // hunter looking for objects to bring to the cache
+      STATE_GRABING,              // hunter bringing an object to the cache
+      STATE_WALK_AWAY,            // hunter walking away from the object it dropped
+      STATE_WAIT,                 // nester waiting for objects to appear in the cache
+      STATE_CACHING_NESTING,      // nester walking into the cache to get the object
+      STATE_CACHING_NESTING_BACK, // nester walking back off the cache
+      STATE_GRABING_NESTING,      // nester bringing an object to the nest
+      STATE_WALK_AWAY_NESTING,    // nester walking at random to avoid tunnel vision on the object
+      STATE_UNLOADING,            // nester unloading the object in the nest
+      STATE_FINISHING             // nester walking around the nest to push the last objects in it
+   };
+
+   /**
+    * The 8 parameters tuned by PSO, in the order of the parameters file
+    */
+   struct SParameters {
+      Real Speed;
+      Real SpeedWalkAway;
+      Real LightValueFinishing;
+      Real DistanceAvoidRobot;
+      Real ReachLight;
+      SInt32 StartJob;
+      SInt32 ToFinishing;
+      SInt32 ToWaiter;
+   };
+
+   /**
+    * Closest thing of one kind seen by the robot at the last reading of its sensors
+    */
+   struct SPerception {
+      bool Sensed;
+      Real Angle;
+      Real Distance;
+   };
+
+public:
+
+   CForagingController();
+   virtual ~CForagingController() {}
+
+   virtual void Init(TConfigurationNode& t_node);
+   virtual void ControlStep();
+   virtual void Reset();
+   virtual void Destroy() {}
+
+   /**
+    * Name of the current state, as the STATE variable of the lua script
+    */
+   const char* GetStateName() const;
+
+   /**
+    * Values of the parameters file, pushed by the loop functions so that the file is read once
+    * for all the robots. They are used at the next first step; empty to read the file again.
+    */
+   void SetParameters(const std::vector<Real>& vec_values);
+
+private:
+
+   /* Parameters */
+   void LoadParameters();
+
+   /* Collecting information: each check reads one sensor and stores what it found */
+   bool NeedGroundColor() const;
+   bool NeedClosestObstacle() const;
+   bool NeedClosestRobot() const;
+   bool NeedClosestOccupiedRobot() const;
+   bool NeedClosestObject() const;
+   bool NeedLight() const;
+   bool NeedTouchingObject() const;
+   void CheckGroundColor();
+   void CheckClosestObstacle();
+   void CheckClosestRobot();
+   void CheckClosestOccupiedRobot();
+   void CheckClosestObject();
+   void CheckTouchObjectWithGripper();
+   void CheckLight();
+
+   /* States and jobs */
+   void StartJob();
+   void SwitchJobHunter();
+   void SwitchJobNester();
+   void SwitchState(EState e_state);
+
+   /* Actions */
+   void Avoid(Real f_angle, Real f_slowdown = 1.0f);
+   void AvoidGrey();
+   void Reach(Real f_angle, Real f_slowdown = 1.0f);
+   void ReachWithGripper(Real f_angle);
+   void WalkForward();
+   void WalkBackwards(Real f_slowdown = 1.0f);
+   void GrabObject();
+   void DropObject();
+   void SetVelocity(Real f_left, Real f_right);
+
+   /* Controllers of the two jobs */
+   void HunterStep();
+   void NesterStep();
+
+private:
+
+   CCI_DifferentialSteeringActuator* m_pcWheels;
+   CCI_LEDsActuator* m_pcLEDs;
+   CCI_FootBotGripperActuator* m_pcGripper;
+   CCI_FootBotTurretActuator* m_pcTurret;
+   CCI_ColoredBlobOmnidirectionalCameraSensor* m_pcCamera;
+   CCI_FootBotTurretEncoderSensor* m_pcTurretEncoder;
+   CCI_FootBotProximitySensor* m_pcProximity;
+   CCI_FootBotLightSensor* m_pcLight;
+   CCI_FootBotMotorGroundSensor* m_pcGround;
+
+   SParameters m_sParams;
+   std::vector<Real> m_vecPushedParameters;
+
+   /* Derived parameters, set with the parameters */
+   SInt32 m_nGrabingMaxForHunter;
+   SInt32 m_nGrabingMaxForNester;
+   SInt32 m_nWalkAwayMax;
+   SInt32 m_nSteppingInCacheMax;
+   SInt32 m_nLeavingCacheMax;
+   SInt32 m_nUnloadingAdvance;
+   SInt32 m_nReachObjectMax;
+   Real m_fDistanceAvoidRobotClose;
+   Real m_fDistanceAvoidRobotMedium;
+   Real m_fDistanceAvoidRobotHigh;
+
+   EJob m_eJob;
+   EState m_eState;
+
+   /* Grey levels of the cache and the nest, once the robot is sure of them */
+   bool m_bCacheKnown, m_bNestKnown, m_bTempKnown;
+   Real m_fFloorCache, m_fFloorNest, m_fFloorTemp;
+
+   SPerception m_sObstacle;
+   SPerception m_sRobot;
+   SPerception m_sOccupiedRobot;
+   SPerception m_sObject;
+
+   bool m_bLightSensed;
+   Real m_fLightAngle;
+   Real m_fLightValue;
+
+   bool m_bGreySensed;
+   bool m_bGreyAngles[4];
+   Real m_fGreyValue;
+
+   bool m_bTouchingObjectWithGripper;
+   bool m_bGrabingObject;
+
+   /* Counters */
+   SInt32 m_nGrabing;
+   SInt32 m_nWalkAway;
+   SInt32 m_nGlobal;
+   SInt32 m_nSteppingInCache;
+   SInt32 m_nLeavingCache;
+   SInt32 m_nUnloading;
+   SInt32 m_nReachObject;
+   SInt32 m_nFinishing;
+};
+
+#endif
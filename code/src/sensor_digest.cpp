@@ -0,0 +1,147 @@
+#include "sensor_digest.h"
+
+/****************************************/
+/****************************************/
+
+/* The constants of the lua script, the results must be the ones of its check functions */
+static const Real PI_LUA              = 3.14159265359;
+static const Real NOT_SENSED_DISTANCE = 1000000;
+static const Real TOUCH_DISTANCE      = 19;
+static const Real TOUCH_ANGLE         = 0.3;
+
+/* Arguments of sensor_digest() */
+static const int ARG_OBSTACLE         = 1;
+static const int ARG_ROBOT            = 2;
+static const int ARG_OCCUPIED_ROBOT   = 3;
+static const int ARG_OBJECT           = 4;
+static const int ARG_LIGHT            = 5;
+static const int ARG_NEED_TOUCHING    = 6;
+
+/* Colours of the blobs, compared on their red, green and blue channels like the strings of the lua script */
+static bool IsColor(const CColor& c_color, UInt8 un_red, UInt8 un_green, UInt8 un_blue) {
+   return c_color.GetRed() == un_red && c_color.GetGreen() == un_green && c_color.GetBlue() == un_blue;
+}
+
+/* Angle of the proximity and light sensor i (from 1 to 24), as to_radian() of the lua script */
+static Real ToRadian(UInt32 un_index) {
+   Real fIndex = un_index;
+   if(fIndex <= 12) {
+      return (fIndex / 12.5) * PI_LUA;
+   }
+   return (-((25 - fIndex) / 12.5)) * PI_LUA;
+}
+
+/* Writes a summary in the table of the script at the given index */
+static void SetSummary(lua_State* pt_lua_state, int n_table, bool b_sensed, Real f_angle, const char* pch_key, Real f_value) {
+   lua_pushboolean(pt_lua_state, b_sensed);
+   lua_setfield(pt_lua_state, n_table, "sensed");
+   lua_pushnumber(pt_lua_state, f_angle);
+   lua_setfield(pt_lua_state, n_table, "angle");
+   lua_pushnumber(pt_lua_state, f_value);
+   lua_setfield(pt_lua_state, n_table, pch_key);
+}
+
+/****************************************/
+/****************************************/
+
+CSensorDigest::CSensorDigest(CCI_Controller& c_controller) :
+   m_pcCamera(c_controller.GetSensor<CCI_ColoredBlobOmnidirectionalCameraSensor>("colored_blob_omnidirectional_camera")),
+   m_pcProximity(c_controller.GetSensor<CCI_FootBotProximitySensor>("footbot_proximity")),
+   m_pcLight(c_controller.GetSensor<CCI_FootBotLightSensor>("footbot_light")),
+   m_pcTurretEncoder(c_controller.GetSensor<CCI_FootBotTurretEncoderSensor>("footbot_turret_encoder")) {
+}
+
+/****************************************/
+/****************************************/
+
+bool CSensorDigest::CanDigest(const CCI_Controller& c_controller) {
+   return c_controller.HasSensor("colored_blob_omnidirectional_camera") &&
+          c_controller.HasSensor("footbot_proximity") &&
+          c_controller.HasSensor("footbot_light") &&
+          c_controller.HasSensor("footbot_turret_encoder");
+}
+
+/****************************************/
+/****************************************/
+
+void CSensorDigest::Register(lua_State* pt_lua_state) {
+   lua_pushlightuserdata(pt_lua_state, this);
+   lua_pushcclosure(pt_lua_state, &CSensorDigest::LuaSensorDigest, 1);
+   lua_setglobal(pt_lua_state, "sensor_digest");
+}
+
+/****************************************/
+/****************************************/
+
+int CSensorDigest::LuaSensorDigest(lua_State* pt_lua_state) {
+   CSensorDigest* pcDigest = static_cast<CSensorDigest*>(lua_touserdata(pt_lua_state, lua_upvalueindex(1)));
+
+   /* Proximity and light: the strongest reading of each, the first one on ties */
+   const CCI_FootBotProximitySensor::TReadings& tProximity = pcDigest->m_pcProximity->GetReadings();
+   const CCI_FootBotLightSensor::TReadings& tLight = pcDigest->m_pcLight->GetReadings();
+   Real fObstacleDistance = 0, fLightValue = 0;
+   UInt32 unObstacle = 0, unLight = 0;
+   for(UInt32 i = 0; i < 24; ++i) {
+      if(tProximity[i].Value > fObstacleDistance) {
+         fObstacleDistance = tProximity[i].Value;
+         unObstacle = i + 1;
+      }
+      if(tLight[i].Value > fLightValue) {
+         fLightValue = tLight[i].Value;
+         unLight = i + 1;
+      }
+   }
+
+   /* Blobs: the closest robot, occupied robot and object, and the closest object in front of the gripper */
+   const CCI_ColoredBlobOmnidirectionalCameraSensor::TBlobList& tBlobs = pcDigest->m_pcCamera->GetReadings().BlobList;
+   Real fTurretRotation = pcDigest->m_pcTurretEncoder->GetRotation().GetValue();
+   Real fRobotDistance = NOT_SENSED_DISTANCE, fOccupiedDistance = NOT_SENSED_DISTANCE;
+   Real fObjectDistance = NOT_SENSED_DISTANCE, fTouchDistance = NOT_SENSED_DISTANCE;
+   Real fRobotAngle = 0, fOccupiedAngle = 0, fObjectAngle = 0;
+   for(size_t i = 0; i < tBlobs.size(); ++i) {
+      const CColor& cColor = tBlobs[i]->Color;
+      Real fDistance = tBlobs[i]->Distance;
+      Real fAngle = tBlobs[i]->Angle.GetValue();
+      if(IsColor(cColor, 255, 0, 0)) { // object
+         if(fDistance < fObjectDistance) {
+            fObjectDistance = fDistance;
+            fObjectAngle = fAngle;
+         }
+         if(Abs(fAngle - fTurretRotation) < TOUCH_ANGLE && fDistance < fTouchDistance) {
+            fTouchDistance = fDistance;
+         }
+      }
+      else if(IsColor(cColor, 255, 255, 255) || IsColor(cColor, 0, 255, 0)) { // hunter or nester
+         if(fDistance < fRobotDistance) {
+            fRobotDistance = fDistance;
+            fRobotAngle = fAngle;
+         }
+      }
+      else if(IsColor(cColor, 0, 255, 255)) { // do not disturb
+         if(fDistance < fOccupiedDistance) {
+            fOccupiedDistance = fDistance;
+            fOccupiedAngle = fAngle;
+         }
+      }
+   }
+
+   /* Only the summaries the script asked for are written */
+   if(lua_istable(pt_lua_state, ARG_OBSTACLE)) {
+      SetSummary(pt_lua_state, ARG_OBSTACLE, unObstacle > 0, unObstacle > 0 ? ToRadian(unObstacle) : 0, "distance", fObstacleDistance);
+   }
+   if(lua_istable(pt_lua_state, ARG_ROBOT)) {
+      SetSummary(pt_lua_state, ARG_ROBOT, fRobotDistance < NOT_SENSED_DISTANCE, fRobotAngle, "distance", fRobotDistance);
+   }
+   if(lua_istable(pt_lua_state, ARG_OCCUPIED_ROBOT)) {
+      SetSummary(pt_lua_state, ARG_OCCUPIED_ROBOT, fOccupiedDistance < NOT_SENSED_DISTANCE, fOccupiedAngle, "distance", fOccupiedDistance);
+   }
+   if(lua_istable(pt_lua_state, ARG_OBJECT)) {
+      SetSummary(pt_lua_state, ARG_OBJECT, fObjectDistance < NOT_SENSED_DISTANCE, fObjectAngle, "distance", fObjectDistance);
+   }
+   if(lua_istable(pt_lua_state, ARG_LIGHT)) {
+      SetSummary(pt_lua_state, ARG_LIGHT, unLight > 0, unLight > 0 ? ToRadian(unLight) : 0, "value", fLightValue);
+   }
+
+   lua_pushboolean(pt_lua_state, lua_toboolean(pt_lua_state, ARG_NEED_TOUCHING) && fTouchDistance < TOUCH_DISTANCE);
+   return 1;
+}
@@ -0,0 +1,53 @@
+#ifndef SENSOR_DIGEST_H
+#define SENSOR_DIGEST_H
+
+#include <argos3/core/control_interface/ci_controller.h>
+#include <argos3/core/wrappers/lua/lua_utility.h>
+#include <argos3/plugins/robots/generic/control_interface/ci_colored_blob_omnidirectional_camera_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_proximity_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_light_sensor.h>
+#include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_turret_encoder_sensor.h>
+
+using namespace argos;
+
+/**
+ * Native version of the check functions of lua_scripts/pso_solution.lua, registered in the lua
+ * state of a robot as the function sensor_digest(). One call reads the proximity and light
+ * sensors in a single loop and classifies every camera blob once:
+ *
+ *    touching = sensor_digest(obstacle, robot, occupied_robot, object, light, need_touching)
+ *
+ * Each of the first five arguments is the table the script keeps the summary in (OBSTACLE, ROBOT,
+ * ...), or false when the summary isn't needed this step: the table is then left untouched. The
+ * fields and their values are the ones the check functions of the script write. touching is
+ * IS_TOUCHING_OBJECT_WITH_GRIPPER, only meaningful when need_touching is true.
+ */
+class CSensorDigest {
+
+public:
+
+   CSensorDigest(CCI_Controller& c_controller);
+
+   /**
+    * Returns true if the controller has every sensor the digest reads
+    */
+   static bool CanDigest(const CCI_Controller& c_controller);
+
+   /**
+    * Registers sensor_digest() in the given lua state, bound to this digest
+    */
+   void Register(lua_State* pt_lua_state);
+
+private:
+
+   static int LuaSensorDigest(lua_State* pt_lua_state);
+
+private:
+
+   CCI_ColoredBlobOmnidirectionalCameraSensor* m_pcCamera;
+   CCI_FootBotProximitySensor* m_pcProximity;
+   CCI_FootBotLightSensor* m_pcLight;
+   CCI_FootBotTurretEncoderSensor* m_pcTurretEncoder;
+};
+
+#endif